@@ -6,13 +6,13 @@
 //
 // Async logging using global thread pool
 // All loggers created here share same global thread pool.
-// Each log message is pushed to a queue along with a shared pointer to the
+// Each log message is pushed to a queue along with a raw pointer to the
 // logger.
 // If a logger deleted while having pending messages in the queue, it's actual
 // destruction will defer
-// until all its messages are processed by the thread pool.
-// This is because each message in the queue holds a shared_ptr to the
-// originating logger.
+// until all its messages are processed (or overrun) by the thread pool.
+// This is because the thread pool holds a shared_ptr to each logger posting to
+// it, and drops it only once none of its messages is in flight.
 
 #include <spdlog/async_logger.h>
 #include <spdlog/details/registry.h>
@@ -59,6 +59,7 @@ struct async_factory_impl
 
 using async_factory = async_factory_impl<async_overflow_policy::block>;
 using async_factory_nonblock = async_factory_impl<async_overflow_policy::overrun_oldest>;
+using async_factory_discard_new = async_factory_impl<async_overflow_policy::discard_new>;
 
 template<typename Sink, typename... SinkArgs>
 inline std::shared_ptr<spdlog::logger> create_async(std::string logger_name, SinkArgs &&... sink_args)
@@ -73,11 +74,17 @@ inline std::shared_ptr<spdlog::logger> create_async_nb(std::string logger_name,
 }
 
 // set global thread pool.
+inline void init_thread_pool(size_t q_size, size_t thread_count, std::function<void()> on_thread_start,
+    std::function<void()> on_thread_stop, const thread_pool_options &options)
+{
+    auto tp = std::make_shared<details::thread_pool>(q_size, thread_count, on_thread_start, on_thread_stop, options);
+    details::registry::instance().set_tp(std::move(tp));
+}
+
 inline void init_thread_pool(
     size_t q_size, size_t thread_count, std::function<void()> on_thread_start, std::function<void()> on_thread_stop)
 {
-    auto tp = std::make_shared<details::thread_pool>(q_size, thread_count, on_thread_start, on_thread_stop);
-    details::registry::instance().set_tp(std::move(tp));
+    init_thread_pool(q_size, thread_count, on_thread_start, on_thread_stop, thread_pool_options{});
 }
 
 inline void init_thread_pool(size_t q_size, size_t thread_count, std::function<void()> on_thread_start)
@@ -85,6 +92,13 @@ inline void init_thread_pool(size_t q_size, size_t thread_count, std::function<v
     init_thread_pool(q_size, thread_count, on_thread_start, [] {});
 }
 
+// e.g. init_thread_pool(8192, 1, options) with options.queue_type = async_queue_type::lock_free
+inline void init_thread_pool(size_t q_size, size_t thread_count, const thread_pool_options &options)
+{
+    init_thread_pool(
+        q_size, thread_count, [] {}, [] {}, options);
+}
+
 inline void init_thread_pool(size_t q_size, size_t thread_count)
 {
     init_thread_pool(
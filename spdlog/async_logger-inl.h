@@ -6,6 +6,7 @@
 #include <spdlog/sinks/sink.h>
 #include <spdlog/details/thread_pool.h>
 
+#include <cstdio>
 #include <memory>
 #include <string>
 
@@ -19,12 +20,94 @@ inline spdlog::async_logger::async_logger(
     : async_logger(std::move(logger_name), {std::move(single_sink)}, std::move(tp), overflow_policy)
 {}
 
+inline spdlog::async_logger::async_logger(const async_logger &other)
+    : std::enable_shared_from_this<async_logger>(other)
+    , logger(other)
+    , thread_pool_(other.thread_pool_)
+    , overflow_policy_(other.overflow_policy_)
+    , shard_(other.shard_.load(std::memory_order_relaxed))
+{}
+
+// the posting threads forget their counters of this logger
+inline spdlog::async_logger::~async_logger()
+{
+    std::lock_guard<std::mutex> lock(post_counters_mutex_);
+    for (auto &counter : post_counters_)
+    {
+        counter->logger_gone.store(true, std::memory_order_relaxed);
+    }
+}
+
+inline std::uint64_t spdlog::async_logger::next_id_()
+{
+    static std::atomic<std::uint64_t> last_id{0};
+    return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+inline void spdlog::async_logger::set_shard(size_t shard)
+{
+    if (auto pool_ptr = thread_pool_.lock())
+    {
+        pool_ptr->set_shard(*this, shard);
+    }
+    else
+    {
+        throw_spdlog_ex("async_logger: thread pool doesn't exist anymore");
+    }
+}
+
+inline void spdlog::async_logger::set_shard_group(const std::string &group)
+{
+    if (auto pool_ptr = thread_pool_.lock())
+    {
+        pool_ptr->set_shard_group(*this, group);
+    }
+    else
+    {
+        throw_spdlog_ex("async_logger: thread pool doesn't exist anymore");
+    }
+}
+
+inline void spdlog::async_logger::set_deferred_formatting(bool enabled)
+{
+    defer_formatting_.store(enabled, std::memory_order_relaxed);
+}
+
+// the pool refers to this logger by raw pointer in the queued messages, and keeps it alive meanwhile.
+inline void spdlog::async_logger::register_with_(details::thread_pool &pool)
+{
+    if (!registered_.load(std::memory_order_relaxed))
+    {
+        pool.register_logger(shared_from_this());
+    }
+}
+
 // send the log message to the thread pool
 inline void spdlog::async_logger::sink_it_(const details::log_msg &msg)
+{
+    post_log_(msg, details::async_msg_type::log);
+}
+
+// send the captured arguments to the thread pool, to be formatted there
+inline void spdlog::async_logger::sink_deferred_(const details::log_msg &msg)
+{
+    post_log_(msg, details::async_msg_type::deferred_log);
+}
+
+inline void spdlog::async_logger::post_log_(const details::log_msg &msg, details::async_msg_type msg_type)
 {
     if (auto pool_ptr = thread_pool_.lock())
     {
-        pool_ptr->post_log(shared_from_this(), msg, overflow_policy_);
+        register_with_(*pool_ptr);
+        if (!pool_ptr->post_log(this, msg, overflow_policy_, msg_type))
+        {
+            dropped_[msg.level].fetch_add(1, std::memory_order_relaxed);
+            unreported_drops_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (unreported_drops_.load(std::memory_order_relaxed) > 0)
+        {
+            report_drops_(*pool_ptr);
+        }
     }
     else
     {
@@ -37,7 +120,10 @@ inline void spdlog::async_logger::flush_()
 {
     if (auto pool_ptr = thread_pool_.lock())
     {
-        pool_ptr->post_flush(shared_from_this(), overflow_policy_);
+        register_with_(*pool_ptr);
+        // an explicit flush is not dropped silently - wait for room instead
+        auto policy = overflow_policy_ == async_overflow_policy::discard_new ? async_overflow_policy::block : overflow_policy_;
+        pool_ptr->post_flush(this, policy);
     }
     else
     {
@@ -48,21 +134,51 @@ inline void spdlog::async_logger::flush_()
 //
 // backend functions - called from the thread pool to do the actual job
 //
-inline void spdlog::async_logger::backend_sink_it_(const details::log_msg &msg)
+
+// format the payload from the captured arguments, unless none of the sinks uses it.
+// return false (after reporting the error) if the message cannot be formatted.
+inline bool spdlog::async_logger::backend_format_(details::async_msg &msg, details::deferred_formatter &formatter, memory_buf_t &buf)
 {
+    bool payload_used = false;
     for (auto &sink : sinks_)
     {
-        if (sink->should_log(msg.level))
+        if (sink->uses_payload() && sink->should_log(msg.level))
         {
-            try
-            {
-                sink->log(msg);
-            }
-            SPDLOG_LOGGER_CATCH(msg.source)
+            payload_used = true;
+            break;
         }
     }
+    if (!payload_used)
+    {
+        return true;
+    }
 
-    if (should_flush_(msg))
+    try
+    {
+        buf.clear();
+        formatter.format(msg.captured_args, buf);
+        msg.set_payload(string_view_t(buf.data(), buf.size()));
+        return true;
+    }
+    SPDLOG_LOGGER_CATCH(msg.source)
+    return false;
+}
+
+inline void spdlog::async_logger::backend_sink_batch_(const details::log_msg *msgs, size_t count)
+{
+    bool need_flush = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (should_flush_(msgs[i]))
+        {
+            need_flush = true;
+            break;
+        }
+    }
+
+    log_to_sinks_(msgs, count);
+
+    if (need_flush)
     {
         backend_flush_();
     }
@@ -80,6 +196,38 @@ inline void spdlog::async_logger::backend_flush_()
     }
 }
 
+inline size_t spdlog::async_logger::dropped_count(level::level_enum log_level) const
+{
+    return dropped_[log_level].load(std::memory_order_relaxed);
+}
+
+inline size_t spdlog::async_logger::dropped_count() const
+{
+    size_t total = 0;
+    for (auto &dropped : dropped_)
+    {
+        total += dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// log the number of messages dropped since the last report
+inline void spdlog::async_logger::report_drops_(details::thread_pool &pool)
+{
+    auto dropped = unreported_drops_.exchange(0, std::memory_order_relaxed);
+    if (dropped == 0)
+    {
+        return;
+    }
+    char buf[64];
+    auto msg_size = ::snprintf(buf, sizeof(buf), "%zu messages dropped (async queue full)", dropped);
+    details::log_msg dropped_msg{name_, level::warn, string_view_t{buf, static_cast<size_t>(msg_size)}};
+    if (!pool.post_log(this, dropped_msg, overflow_policy_))
+    {
+        unreported_drops_.fetch_add(dropped, std::memory_order_relaxed);
+    }
+}
+
 inline std::shared_ptr<spdlog::logger> spdlog::async_logger::clone(std::string new_name)
 {
     auto cloned = std::make_shared<spdlog::async_logger>(*this);
@@ -5,7 +5,8 @@
 
 // Fast asynchronous logger.
 // Uses pre allocated queue.
-// Creates a single back thread to pop messages from the queue and log them.
+// Posts to a thread pool, whose worker threads pop messages from the queue
+// (of the logger's shard) and log them.
 //
 // Upon each log write the logger:
 //    1. Checks if its log level is enough to log the message
@@ -16,19 +17,96 @@
 
 #include <spdlog/logger.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 namespace spdlog {
 
 // Async overflow policy - block by default.
 enum class async_overflow_policy
 {
-    block,         // Block until message can be enqueued
-    overrun_oldest // Discard oldest message in the queue if full when trying to
-                   // add new item.
+    block,          // Block until message can be enqueued
+    overrun_oldest, // Discard oldest message in the queue if full when trying to
+                    // add new item.
+    discard_new     // Discard the new message if the queue is full (counted by the logger,
+                    // see async_logger::dropped_count(..)). Flush requests are never discarded,
+                    // they wait for room in the queue.
+};
+
+// Async queue implementation used by the thread pool - mutex protected by default.
+enum class async_queue_type
+{
+    blocking,         // Mutex protected queue.
+    lock_free,        // Bounded lock-free queue. Producers and workers take a lock
+                      // only to park when the queue is full (or empty).
+    per_thread_lanes, // Each producer thread gets its own lock-free lane of q_size items.
+                      // Workers merge the lanes in posting order (not by message time).
+    elastic           // Mutex protected queue of up to q_size items, allocated in segments
+                      // on demand (see thread_pool_options::elastic_segment_size).
+};
+
+// How async workers (and producers blocked by a full queue) wait - parked right away by default.
+enum class async_wait_strategy
+{
+    park,          // Park on a condition variable.
+    spin_then_park // Busy-spin, then yield, then park. Lower wake-up latency,
+                   // at the cost of burning cpu while waiting.
+};
+
+// Thread pool options (see spdlog::init_thread_pool(..)).
+struct thread_pool_options
+{
+    async_queue_type queue_type = async_queue_type::blocking;
+
+    // Max number of messages a worker pops from the queue at once. Consecutive
+    // messages of the same logger are handed to its sinks as one batch (see sink::log_batch(..)).
+    size_t max_batch_size = 64;
+
+    async_wait_strategy wait_strategy = async_wait_strategy::park;
+
+    // Number of busy-spin and yield rounds before parking (with async_wait_strategy::spin_then_park).
+    size_t spin_count = 2000;
+    size_t yield_count = 100;
+
+    // Number of shards. Each shard has its own queue (of q_size items) served by its own
+    // thread_count workers. An async logger always posts to the same shard, so loggers of
+    // different shards never wait for each other. The shard is set explicitly (see
+    // async_logger::set_shard(..)), or else given on first use to the logger's name or shard
+    // group (see async_logger::set_shard_group(..)), round-robin: the first `shards` names
+    // or groups get a shard of their own.
+    size_t shards = 1;
+
+    // Messages at or above priority_level go to a separate queue of priority_q_size items
+    // (per shard), which the workers always drain first. So they neither wait behind nor
+    // overrun lower level messages (level::off - disabled).
+    level::level_enum priority_level = level::off;
+    size_t priority_q_size = 1024;
+
+    // Worker threads setup, applied before on_thread_start() (best effort - failures are ignored).
+    std::vector<size_t> cpu_affinity; // Cpus the workers may run on (empty - any).
+    std::string thread_name;          // Workers are named "<thread_name><index>", truncated to 15 chars (empty - not named).
+    int nice_increment = 0;           // Added to the workers' nice value.
+    bool sched_idle = false;          // Run the workers with the SCHED_IDLE policy.
+
+    // Elastic queue (async_queue_type::elastic) starts with a single segment of elastic_segment_size
+    // items and grows by more segments during bursts, up to q_size items. The segments left over
+    // from a burst are freed once no burst was seen for elastic_shrink_after.
+    size_t elastic_segment_size = 256;
+    std::chrono::milliseconds elastic_shrink_after{std::chrono::seconds(30)};
 };
 
 namespace details {
 class thread_pool;
-}
+struct async_msg;
+struct post_counter;
+enum class async_msg_type;
+} // namespace details
 
 class async_logger final : public std::enable_shared_from_this<async_logger>, public logger
 {
@@ -49,17 +127,62 @@ public:
     async_logger(std::string logger_name, sink_ptr single_sink, std::weak_ptr<details::thread_pool> tp,
         async_overflow_policy overflow_policy = async_overflow_policy::block);
 
+    // a copy registers itself with the thread pool on its own, and posts to the same shard
+    async_logger(const async_logger &other);
+
+    ~async_logger() override;
+
     std::shared_ptr<logger> clone(std::string new_name) override;
 
+    // number of messages discarded with async_overflow_policy::discard_new, at the given level (or at all levels).
+    // once messages get through again, a warning with the number of messages dropped meanwhile is logged.
+    size_t dropped_count(level::level_enum log_level) const;
+    size_t dropped_count() const;
+
+    // post to the given thread pool shard (0..thread_pool::shards()-1).
+    // the shard is set once, before the logger is used - throw spdlog_ex otherwise.
+    void set_shard(size_t shard);
+
+    // post to the shard of the given group instead of the shard of the logger name.
+    // loggers of the same group share a shard. the shard is set once, before the logger is used -
+    // throw spdlog_ex otherwise.
+    void set_shard_group(const std::string &group);
+
+    // format the messages on the thread pool instead of the calling thread. the format string
+    // and the arguments are copied into the queue, if they are all arithmetic types or strings
+    // (calls with other argument types, or while backtrace is enabled, are formatted right away).
+    void set_deferred_formatting(bool enabled);
+
 protected:
     void sink_it_(const details::log_msg &msg) override;
+    void sink_deferred_(const details::log_msg &msg) override;
     void flush_() override;
-    void backend_sink_it_(const details::log_msg &incoming_log_msg);
+    bool backend_format_(details::async_msg &msg, details::deferred_formatter &formatter, memory_buf_t &buf);
+    void backend_sink_batch_(const details::log_msg *msgs, size_t count);
     void backend_flush_();
 
 private:
     std::weak_ptr<details::thread_pool> thread_pool_;
     async_overflow_policy overflow_policy_;
+    // the thread pool shard + 1 (0 - not set yet, see thread_pool::shard_of(..))
+    std::atomic<size_t> shard_{0};
+    // set while the thread pool keeps this logger alive (see thread_pool::register_logger(..))
+    std::atomic<bool> registered_{false};
+    // the messages posted to the thread pool, and those processed (or overrun) - none is in flight
+    // once they are equal (see thread_pool::register_logger(..)). the posts are counted by each thread
+    // in its own counter (see thread_pool::post_counter_(..)), the processed messages per batch.
+    const std::uint64_t id_ = next_id_(); // finds the posting thread's counter
+    std::mutex post_counters_mutex_;
+    std::vector<std::shared_ptr<details::post_counter>> post_counters_;
+    std::atomic<size_t> shared_posted_{0}; // posts of threads without a counter (SPDLOG_NO_TLS, thread exiting)
+    std::atomic<size_t> processed_{0};
+    std::atomic<size_t> dropped_[level::n_levels]{};
+    std::atomic<size_t> unreported_drops_{0};
+
+    static std::uint64_t next_id_();
+    void register_with_(details::thread_pool &pool);
+    void post_log_(const details::log_msg &msg, details::async_msg_type msg_type);
+    void report_drops_(details::thread_pool &pool);
 };
 } // namespace spdlog
 
@@ -164,6 +164,17 @@ enum class pattern_time_type
     utc    // log utc
 };
 
+//
+// Compression of the rotated log files, by the rotating, daily and hourly file sinks
+// (see their set_compression(..)).
+// gzip needs SPDLOG_USE_ZLIB to be defined (and linking with zlib).
+//
+enum class file_compression
+{
+    none,
+    gzip // log.1.txt -> log.1.txt.gz
+};
+
 //
 // Log exception
 //
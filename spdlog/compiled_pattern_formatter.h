@@ -0,0 +1,333 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Pattern formatter for patterns known at compile time.
+// The pattern is parsed by the compiler into a fixed sequence of the same flag
+// formatters pattern_formatter uses, called directly (no virtual calls), with
+// the text between flags appended in one go. The output is the same as
+// pattern_formatter's, except that custom flags are not supported.
+//
+// Usage (the pattern must be a string literal of up to 128 chars):
+//     using my_formatter = SPDLOG_COMPILED_PATTERN("[%H:%M:%S.%e] [%l] %v");
+//     sink->set_formatter(spdlog::details::make_unique<my_formatter>());
+
+#include <spdlog/details/tm_cache.h>
+#include <spdlog/pattern_formatter.h>
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+namespace spdlog {
+namespace details {
+namespace compiled_pattern {
+
+static constexpr size_t max_pattern_size = 128;
+
+template<size_t N>
+constexpr char char_at(const char (&str)[N], size_t i)
+{
+    return i < N ? str[i] : '\0';
+}
+
+// literal text
+template<char... Chars>
+struct literal
+{
+    static constexpr bool needs_tm = false;
+
+    void format(const log_msg &, const std::tm &, memory_buf_t &dest)
+    {
+        static constexpr char str[] = {Chars...};
+        dest.append(str, str + sizeof...(Chars));
+    }
+};
+
+// a flag formatted by the given pattern_formatter flag formatter
+template<typename Formatter, bool NeedsTm, bool Padded, size_t Width, padding_info::pad_side Side, bool Truncate>
+struct flag
+{
+    static constexpr bool needs_tm = NeedsTm;
+
+    flag()
+        : formatter_(Padded ? padding_info{Width, Side, Truncate} : padding_info{})
+    {}
+
+    void format(const log_msg &msg, const std::tm &tm_time, memory_buf_t &dest)
+    {
+        // qualified - not a virtual call
+        formatter_.Formatter::format(msg, tm_time, dest);
+    }
+
+    Formatter formatter_;
+};
+
+template<typename Padder>
+using elapsed_nanos_formatter = elapsed_formatter<Padder, std::chrono::nanoseconds>;
+template<typename Padder>
+using elapsed_micros_formatter = elapsed_formatter<Padder, std::chrono::microseconds>;
+template<typename Padder>
+using elapsed_millis_formatter = elapsed_formatter<Padder, std::chrono::milliseconds>;
+template<typename Padder>
+using elapsed_secs_formatter = elapsed_formatter<Padder, std::chrono::seconds>;
+
+// maps a flag char to its formatter, as pattern_formatter::handle_flag_(..) does
+template<char Flag, typename Padder>
+struct flag_formatter_of
+{
+    using type = void; // unknown flag
+    static constexpr bool needs_tm = false;
+};
+
+#define SPDLOG_COMPILED_FLAG_(flag_char, formatter_type, tm)                                                                               \
+    template<typename Padder>                                                                                                              \
+    struct flag_formatter_of<flag_char, Padder>                                                                                            \
+    {                                                                                                                                      \
+        using type = formatter_type;                                                                                                       \
+        static constexpr bool needs_tm = tm;                                                                                               \
+    };
+
+SPDLOG_COMPILED_FLAG_('+', full_formatter, true)
+SPDLOG_COMPILED_FLAG_('n', name_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('l', level_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('L', short_level_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('t', t_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('v', v_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('a', a_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('A', A_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('b', b_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('h', b_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('B', B_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('c', c_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('C', C_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('Y', Y_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('D', D_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('x', D_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('m', m_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('d', d_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('H', H_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('I', I_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('M', M_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('S', S_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('e', e_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('f', f_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('F', F_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('E', E_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('p', p_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('r', r_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('R', R_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('T', T_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('X', T_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('z', z_formatter<Padder>, true)
+SPDLOG_COMPILED_FLAG_('P', pid_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('^', color_start_formatter, false)
+SPDLOG_COMPILED_FLAG_('$', color_stop_formatter, false)
+SPDLOG_COMPILED_FLAG_('@', source_location_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('s', short_filename_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('g', source_filename_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('#', source_linenum_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('!', source_funcname_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('u', elapsed_nanos_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('i', elapsed_micros_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('o', elapsed_millis_formatter<Padder>, false)
+SPDLOG_COMPILED_FLAG_('O', elapsed_secs_formatter<Padder>, false)
+#undef SPDLOG_COMPILED_FLAG_
+
+template<char Flag, bool Padded, size_t Width, padding_info::pad_side Side, bool Truncate>
+struct make_flag
+{
+    using padder = typename std::conditional<Padded, scoped_padder, null_scoped_padder>::type;
+    using formatter_of = flag_formatter_of<Flag, padder>;
+    using type = flag<typename formatter_of::type, formatter_of::needs_tm, Padded, (Width < 64 ? Width : 64), Side, Truncate>;
+};
+
+// type list helpers
+template<typename... Items>
+struct item_list
+{};
+
+template<typename Items, typename Item>
+struct push_item;
+
+template<typename... Items, typename Item>
+struct push_item<item_list<Items...>, Item>
+{
+    using type = item_list<Items..., Item>;
+};
+
+template<typename... Items>
+struct push_item<item_list<Items...>, literal<>>
+{
+    using type = item_list<Items...>;
+};
+
+template<typename Literal, char... Chars>
+struct push_chars;
+
+template<char... Literal, char... Chars>
+struct push_chars<literal<Literal...>, Chars...>
+{
+    using type = literal<Literal..., Chars...>;
+};
+
+// the pattern parser - its type is the list of items found in Chars, which ends at the first '\0'.
+// Items are the items found so far, Literal the literal chars found after them.
+template<typename Items, typename Literal, char... Chars>
+struct parser
+{
+    using type = typename push_item<Items, Literal>::type;
+};
+
+// after '%': [side][width][!]flag - see pattern_formatter::handle_padspec_(..)
+template<typename Items, typename Literal, char... Chars>
+struct side_parser : parser<Items, Literal> // the pattern ends with '%'
+{};
+
+template<typename Items, typename Literal, padding_info::pad_side Side, size_t Width, bool Padded, bool Truncate, char... Chars>
+struct spec_parser : parser<Items, Literal> // the pattern ends in a pad spec
+{};
+
+template<typename Items, typename Literal, padding_info::pad_side Side, size_t Width, bool Padded, bool Truncate, char Flag, char... Chars>
+struct flag_parser;
+
+template<typename Items, typename Literal, char Ch, char... Chars>
+struct parser<Items, Literal, Ch, Chars...>
+    : std::conditional<Ch == '\0', parser<Items, Literal>,
+          typename std::conditional<Ch == '%', side_parser<Items, Literal, Chars...>,
+              parser<Items, typename push_chars<Literal, Ch>::type, Chars...>>::type>::type
+{};
+
+template<typename Items, typename Literal, char Ch, char... Chars>
+struct side_parser<Items, Literal, Ch, Chars...>
+    : std::conditional<Ch == '\0', parser<Items, Literal>,
+          typename std::conditional<Ch == '-', spec_parser<Items, Literal, padding_info::pad_side::right, 0, false, false, Chars...>,
+              typename std::conditional<Ch == '=', spec_parser<Items, Literal, padding_info::pad_side::center, 0, false, false, Chars...>,
+                  spec_parser<Items, Literal, padding_info::pad_side::left, 0, false, false, Ch, Chars...>>::type>::type>::type
+{};
+
+template<typename Items, typename Literal, padding_info::pad_side Side, size_t Width, bool Padded, bool Truncate, char Ch, char... Chars>
+struct spec_parser<Items, Literal, Side, Width, Padded, Truncate, Ch, Chars...>
+    : std::conditional<Ch == '\0', parser<Items, Literal>,
+          typename std::conditional<(Ch >= '0' && Ch <= '9' && !Truncate),
+              spec_parser<Items, Literal, Side, Width * 10 + static_cast<size_t>(Ch - '0'), true, false, Chars...>,
+              typename std::conditional<(Ch == '!' && Padded && !Truncate), spec_parser<Items, Literal, Side, Width, true, true, Chars...>,
+                  flag_parser<Items, Literal, Side, Width, Padded, Truncate, Ch, Chars...>>::type>::type>::type
+{};
+
+template<typename Items, typename Literal, padding_info::pad_side Side, size_t Width, bool Padded, bool Truncate, char Flag, char... Chars>
+struct flag_parser
+    : std::conditional<Flag == '%', parser<Items, typename push_chars<Literal, '%'>::type, Chars...>,
+          typename std::conditional<std::is_void<typename flag_formatter_of<Flag, null_scoped_padder>::type>::value,
+              // unknown flag - appears as is. but after a truncate mark, the '!' was the funcname flag
+              // (see pattern_formatter::handle_flag_(..)).
+              typename std::conditional<Truncate,
+                  parser<typename push_item<typename push_item<Items, Literal>::type, typename make_flag<'!', Padded, Width, Side, false>::type>::type,
+                      literal<Flag>, Chars...>,
+                  parser<Items, typename push_chars<Literal, '%', Flag>::type, Chars...>>::type,
+              parser<typename push_item<typename push_item<Items, Literal>::type, typename make_flag<Flag, Padded, Width, Side, Truncate>::type>::type,
+                  literal<>, Chars...>>::type>::type
+{};
+
+// the items of a parsed pattern
+template<typename Items>
+struct items_of;
+
+template<>
+struct items_of<item_list<>>
+{
+    using tuple = std::tuple<>;
+    static constexpr bool needs_tm = false;
+};
+
+template<typename Item, typename... Items>
+struct items_of<item_list<Item, Items...>>
+{
+    using tuple = std::tuple<Item, Items...>;
+    static constexpr bool needs_tm = Item::needs_tm || items_of<item_list<Items...>>::needs_tm;
+};
+
+} // namespace compiled_pattern
+} // namespace details
+
+template<size_t PatternSize, char... Pattern>
+class compiled_pattern_formatter final : public formatter
+{
+public:
+    static_assert(PatternSize <= details::compiled_pattern::max_pattern_size, "compiled pattern too long");
+
+    explicit compiled_pattern_formatter(pattern_time_type time_type = pattern_time_type::local, std::string eol = spdlog::details::os::default_eol)
+        : eol_(std::move(eol))
+        , pattern_time_type_(time_type)
+        , last_log_secs_(0)
+    {
+        std::memset(&cached_tm_, 0, sizeof(cached_tm_));
+    }
+
+    compiled_pattern_formatter(const compiled_pattern_formatter &other) = delete;
+    compiled_pattern_formatter &operator=(const compiled_pattern_formatter &other) = delete;
+
+    std::unique_ptr<formatter> clone() const override
+    {
+        return details::make_unique<compiled_pattern_formatter>(pattern_time_type_, eol_);
+    }
+
+    void format(const details::log_msg &msg, memory_buf_t &dest) override
+    {
+        if (items::needs_tm)
+        {
+            const auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.time.time_since_epoch());
+            if (secs != last_log_secs_)
+            {
+                cached_tm_ = details::tm_cache::instance(pattern_time_type_).get(log_clock::to_time_t(msg.time));
+                last_log_secs_ = secs;
+            }
+        }
+        format_items_<0>(msg, dest);
+        details::fmt_helper::append_string_view(eol_, dest);
+    }
+
+private:
+    using items = details::compiled_pattern::items_of<typename details::compiled_pattern::parser<details::compiled_pattern::item_list<>,
+        details::compiled_pattern::literal<>, Pattern...>::type>;
+    using items_tuple = typename items::tuple;
+
+    template<size_t I>
+    typename std::enable_if<(I < std::tuple_size<items_tuple>::value)>::type format_items_(const details::log_msg &msg, memory_buf_t &dest)
+    {
+        std::get<I>(items_).format(msg, cached_tm_, dest);
+        format_items_<I + 1>(msg, dest);
+    }
+
+    template<size_t I>
+    typename std::enable_if<(I == std::tuple_size<items_tuple>::value)>::type format_items_(const details::log_msg &, memory_buf_t &)
+    {}
+
+    std::string eol_;
+    pattern_time_type pattern_time_type_;
+    std::tm cached_tm_;
+    std::chrono::seconds last_log_secs_;
+    items_tuple items_;
+};
+} // namespace spdlog
+
+#define SPDLOG_COMPILED_PATTERN_CHARS_8_(pattern, i)                                                                                       \
+    ::spdlog::details::compiled_pattern::char_at(pattern, i), ::spdlog::details::compiled_pattern::char_at(pattern, i + 1),                \
+        ::spdlog::details::compiled_pattern::char_at(pattern, i + 2), ::spdlog::details::compiled_pattern::char_at(pattern, i + 3),        \
+        ::spdlog::details::compiled_pattern::char_at(pattern, i + 4), ::spdlog::details::compiled_pattern::char_at(pattern, i + 5),        \
+        ::spdlog::details::compiled_pattern::char_at(pattern, i + 6), ::spdlog::details::compiled_pattern::char_at(pattern, i + 7)
+
+#define SPDLOG_COMPILED_PATTERN_CHARS_32_(pattern, i)                                                                                      \
+    SPDLOG_COMPILED_PATTERN_CHARS_8_(pattern, i), SPDLOG_COMPILED_PATTERN_CHARS_8_(pattern, i + 8),                                        \
+        SPDLOG_COMPILED_PATTERN_CHARS_8_(pattern, i + 16), SPDLOG_COMPILED_PATTERN_CHARS_8_(pattern, i + 24)
+
+// the compiled_pattern_formatter type of the given string literal pattern
+#define SPDLOG_COMPILED_PATTERN(pattern)                                                                                                   \
+    ::spdlog::compiled_pattern_formatter<sizeof(pattern) - 1, SPDLOG_COMPILED_PATTERN_CHARS_32_(pattern, 0),                              \
+        SPDLOG_COMPILED_PATTERN_CHARS_32_(pattern, 32), SPDLOG_COMPILED_PATTERN_CHARS_32_(pattern, 64),                                    \
+        SPDLOG_COMPILED_PATTERN_CHARS_32_(pattern, 96)>
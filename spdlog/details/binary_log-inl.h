@@ -0,0 +1,388 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace spdlog {
+namespace details {
+namespace binary_log {
+
+static const char magic[] = {'s', 'p', 'd', 'l', 'o', 'g', 'b'};
+static const char version = 2;
+static const char dictionary_tag = 'D';
+static const char record_tag = 'L';
+
+inline void write_varint(memory_buf_t &dest, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        dest.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    dest.push_back(static_cast<char>(value));
+}
+
+inline unsigned long long zigzag(long long value)
+{
+    return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+}
+
+inline long long unzigzag(unsigned long long value)
+{
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+inline size_t hash(string_view_t str)
+{
+    // FNV-1a
+    unsigned long long h = 14695981039346656037ull;
+    for (char c : str)
+    {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return static_cast<size_t>(h);
+}
+
+inline string_view_t to_view(const char *str)
+{
+    return str != nullptr ? string_view_t{str, std::strlen(str)} : string_view_t{};
+}
+
+} // namespace binary_log
+
+inline void binary_log_encoder::begin(memory_buf_t &dest)
+{
+    ids_by_hash_.clear();
+    strings_.clear();
+    last_time_ = 0;
+    dest.append(binary_log::magic, binary_log::magic + sizeof(binary_log::magic));
+    dest.push_back(binary_log::version);
+    binary_log::write_varint(dest, static_cast<unsigned long long>(details::os::pid()));
+}
+
+inline void binary_log_encoder::encode(const log_msg &msg, memory_buf_t &dest)
+{
+    // the dictionary entries go first
+    size_t logger_id = string_id_(msg.logger_name, dest);
+    size_t file_id = string_id_(binary_log::to_view(msg.source.filename), dest);
+    size_t func_id = string_id_(binary_log::to_view(msg.source.funcname), dest);
+    size_t fmt_id = 0;
+    string_view_t bytes = msg.payload;
+    if (msg.captured_args.size() > 0)
+    {
+        string_view_t fmt;
+        split_deferred(msg.captured_args, fmt, bytes);
+        fmt_id = string_id_(fmt, dest);
+    }
+
+    auto time = msg.time.time_since_epoch().count();
+    dest.push_back(binary_log::record_tag);
+    binary_log::write_varint(dest, binary_log::zigzag(static_cast<long long>(time - last_time_)));
+    last_time_ = time;
+    dest.push_back(static_cast<char>(msg.level));
+    binary_log::write_varint(dest, msg.thread_id);
+    binary_log::write_varint(dest, logger_id);
+    binary_log::write_varint(dest, file_id);
+    binary_log::write_varint(dest, static_cast<unsigned int>(msg.source.line));
+    binary_log::write_varint(dest, func_id);
+    binary_log::write_varint(dest, fmt_id);
+    binary_log::write_varint(dest, bytes.size());
+    dest.append(bytes.data(), bytes.data() + bytes.size());
+}
+
+inline size_t binary_log_encoder::string_id_(string_view_t str, memory_buf_t &dest)
+{
+    if (str.size() == 0)
+    {
+        return 0;
+    }
+    size_t h = binary_log::hash(str);
+    auto range = ids_by_hash_.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const std::string &known = strings_[it->second - 1];
+        if (known.size() == str.size() && std::memcmp(known.data(), str.data(), str.size()) == 0)
+        {
+            return it->second;
+        }
+    }
+
+    strings_.emplace_back(str.data(), str.size());
+    size_t id = strings_.size();
+    ids_by_hash_.emplace(h, id);
+    dest.push_back(binary_log::dictionary_tag);
+    binary_log::write_varint(dest, id);
+    binary_log::write_varint(dest, str.size());
+    dest.append(str.data(), str.data() + str.size());
+    return id;
+}
+
+inline binary_log_decoder::binary_log_decoder(std::FILE *in)
+    : in_(in)
+{}
+
+inline bool binary_log_decoder::next(log_msg &msg)
+{
+    for (;;)
+    {
+        entry_.clear();
+        int tag = get_byte_();
+        if (tag == EOF)
+        {
+            return false;
+        }
+        if (in_damage_ && tag != binary_log::magic[0])
+        {
+            skipped_++;
+            continue;
+        }
+
+        bool is_record;
+        try
+        {
+            is_record = read_entry_(tag, msg);
+        }
+        catch (const std::exception &)
+        {
+            const size_t magic_size = sizeof(binary_log::magic);
+            if (entry_.size() > magic_size && std::memcmp(entry_.data(), binary_log::magic, magic_size) == 0 &&
+                (entry_[magic_size] < 1 || entry_[magic_size] > binary_log::version))
+            {
+                throw; // a header of an unsupported version
+            }
+            skip_damaged_(1);
+            continue;
+        }
+
+        // a partial entry followed by a header may read as a whole entry, ending after the header's start
+        size_t header_pos = header_in_entry_();
+        if (header_pos != 0)
+        {
+            skip_damaged_(header_pos);
+            continue;
+        }
+        if (is_record)
+        {
+            return true;
+        }
+    }
+}
+
+inline bool binary_log_decoder::read_entry_(int tag, log_msg &msg)
+{
+    if (tag == binary_log::magic[0])
+    {
+        char header[sizeof(binary_log::magic)];
+        header[0] = static_cast<char>(tag);
+        for (size_t i = 1; i < sizeof(header); i++)
+        {
+            header[i] = static_cast<char>(read_byte_());
+        }
+        if (std::memcmp(header, binary_log::magic, sizeof(header)) != 0)
+        {
+            throw_spdlog_ex("binary log: bad header");
+        }
+        int file_version = read_byte_();
+        if (file_version < 1 || file_version > binary_log::version)
+        {
+            throw_spdlog_ex("binary log: unsupported version");
+        }
+        pid_ = file_version >= 2 ? static_cast<size_t>(read_varint_()) : 0;
+        strings_.clear();
+        last_time_ = 0;
+        in_damage_ = false;
+        return false;
+    }
+
+    if (tag == binary_log::dictionary_tag)
+    {
+        auto id = read_varint_();
+        if (id != strings_.size() + 1)
+        {
+            throw_spdlog_ex("binary log: unexpected dictionary id");
+        }
+        std::string str;
+        read_bytes_(str, static_cast<size_t>(read_varint_()));
+        strings_.push_back(std::move(str));
+        return false;
+    }
+
+    if (tag == binary_log::record_tag)
+    {
+        auto time = last_time_ + static_cast<log_clock::rep>(binary_log::unzigzag(read_varint_()));
+        int lvl = read_byte_();
+        if (lvl < 0 || lvl >= level::n_levels)
+        {
+            throw_spdlog_ex("binary log: bad level");
+        }
+        msg = log_msg{};
+        msg.time = log_clock::time_point{log_clock::duration{time}};
+        msg.level = static_cast<level::level_enum>(lvl);
+        msg.thread_id = static_cast<size_t>(read_varint_());
+        auto logger_name = string_at_(read_varint_());
+        if (logger_name != nullptr)
+        {
+            msg.logger_name = string_view_t{logger_name->data(), logger_name->size()};
+        }
+        auto filename = string_at_(read_varint_());
+        msg.source.filename = filename != nullptr ? filename->c_str() : nullptr;
+        msg.source.line = static_cast<int>(read_varint_());
+        auto funcname = string_at_(read_varint_());
+        msg.source.funcname = funcname != nullptr ? funcname->c_str() : nullptr;
+        auto fmt = string_at_(read_varint_());
+        read_bytes_(bytes_, static_cast<size_t>(read_varint_()));
+
+        if (fmt == nullptr)
+        {
+            msg.payload = string_view_t{bytes_.data(), bytes_.size()};
+        }
+        else
+        {
+            payload_.clear();
+            formatter_.format(string_view_t{fmt->data(), fmt->size()}, string_view_t{bytes_.data(), bytes_.size()}, payload_);
+            msg.payload = string_view_t{payload_.data(), payload_.size()};
+        }
+        last_time_ = time;
+        return true;
+    }
+
+    throw_spdlog_ex("binary log: unknown record type");
+}
+
+// the dictionary and the time base are not known anymore - skip to the next header
+inline void binary_log_decoder::skip_damaged_(size_t skipped)
+{
+    unread_ = entry_.substr(skipped) + unread_.substr(unread_pos_);
+    unread_pos_ = 0;
+    skipped_ += skipped;
+    in_damage_ = true;
+}
+
+inline size_t binary_log_decoder::header_in_entry_()
+{
+    // the header may start in the entry and end after it
+    const size_t magic_size = sizeof(binary_log::magic);
+    peek_(magic_size + 1);
+    std::string bytes = entry_;
+    bytes.append(unread_, unread_pos_, magic_size + 1);
+    for (size_t pos = bytes.find(binary_log::magic, 1, magic_size); pos != std::string::npos && pos < entry_.size();
+         pos = bytes.find(binary_log::magic, pos + 1, magic_size))
+    {
+        // with a version byte, not to take text for a header
+        if (pos + magic_size < bytes.size() && bytes[pos + magic_size] >= 1 && bytes[pos + magic_size] <= binary_log::version)
+        {
+            return pos;
+        }
+    }
+    return 0;
+}
+
+inline size_t binary_log_decoder::pid() const
+{
+    return pid_;
+}
+
+inline size_t binary_log_decoder::skipped_bytes() const
+{
+    return skipped_;
+}
+
+inline void binary_log_decoder::peek_(size_t size)
+{
+    unread_.erase(0, unread_pos_);
+    unread_pos_ = 0;
+    while (unread_.size() < size)
+    {
+        int c = std::fgetc(in_);
+        if (c == EOF)
+        {
+            break;
+        }
+        unread_.push_back(static_cast<char>(c));
+    }
+}
+
+inline int binary_log_decoder::get_byte_()
+{
+    int c;
+    if (unread_pos_ < unread_.size())
+    {
+        c = static_cast<unsigned char>(unread_[unread_pos_++]);
+    }
+    else
+    {
+        c = std::fgetc(in_);
+        if (c == EOF)
+        {
+            return EOF;
+        }
+    }
+    entry_.push_back(static_cast<char>(c));
+    return c;
+}
+
+inline int binary_log_decoder::read_byte_()
+{
+    int c = get_byte_();
+    if (c == EOF)
+    {
+        throw_spdlog_ex("binary log: unexpected end of file");
+    }
+    return c;
+}
+
+inline unsigned long long binary_log_decoder::read_varint_()
+{
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = read_byte_();
+        value |= static_cast<unsigned long long>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw_spdlog_ex("binary log: bad varint");
+}
+
+inline void binary_log_decoder::read_bytes_(std::string &dest, size_t size)
+{
+    dest.clear();
+    size_t from_unread = (std::min)(size, unread_.size() - unread_pos_);
+    dest.append(unread_, unread_pos_, from_unread);
+    unread_pos_ += from_unread;
+    if (from_unread < size)
+    {
+        dest.resize(size);
+        size_t n = std::fread(&dest[from_unread], 1, size - from_unread, in_);
+        dest.resize(from_unread + n);
+    }
+    entry_.append(dest);
+    if (dest.size() != size)
+    {
+        throw_spdlog_ex("binary log: unexpected end of file");
+    }
+}
+
+inline const std::string *binary_log_decoder::string_at_(unsigned long long id) const
+{
+    if (id == 0)
+    {
+        return nullptr;
+    }
+    if (id > strings_.size())
+    {
+        throw_spdlog_ex("binary log: unknown dictionary id");
+    }
+    return &strings_[static_cast<size_t>(id - 1)];
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,115 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Binary log format, written by sinks::binary_file_sink and read back by
+// binary_log_decoder (see tools/binary_log_decoder.cpp).
+//
+// A file is a sequence of:
+//   header     - "spdlogb", the format version byte, and the varint pid of the
+//                writing process (rendered by %P when decoding). starts a new
+//                dictionary and time base (written on each open, so appending
+//                to an existing file is fine). version 1 headers had no pid.
+//   dictionary - 'D', varint id, varint size, chars. format strings, logger
+//                names and source locations are written once per file, and
+//                referred by id afterwards (0 - none).
+//   record     - 'L', zigzag varint time delta (in log_clock ticks), level byte,
+//                varint thread id, varint logger name id, varint source file id,
+//                varint source line, varint source function id, varint format
+//                string id, varint size, bytes.
+//                the bytes are the arguments captured by the logger (see
+//                details::encode_deferred(..)), or the formatted payload if the
+//                format string id is 0.
+//
+// The captured arguments are in the native byte order and sizes, so files are
+// meant to be decoded on the same platform.
+//
+// A crash may leave a partial entry at the end of a file, followed by the header
+// written when the file is opened again. The decoder skips damaged entries (and
+// entries a header was found in) up to the next header.
+
+#include <spdlog/common.h>
+#include <spdlog/details/deferred_args.h>
+#include <spdlog/details/log_msg.h>
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+
+class binary_log_encoder
+{
+public:
+    // start a new file - write the header and forget the dictionary
+    void begin(memory_buf_t &dest);
+
+    // append the record of the given message (and the dictionary entries it needs) to dest
+    void encode(const log_msg &msg, memory_buf_t &dest);
+
+private:
+    // return the id of str, writing a dictionary entry if seen for the first time in this file
+    size_t string_id_(string_view_t str, memory_buf_t &dest);
+
+    std::unordered_multimap<size_t, size_t> ids_by_hash_;
+    std::vector<std::string> strings_; // by id - 1
+    log_clock::rep last_time_ = 0;
+};
+
+class binary_log_decoder
+{
+public:
+    explicit binary_log_decoder(std::FILE *in);
+
+    binary_log_decoder(const binary_log_decoder &) = delete;
+    binary_log_decoder &operator=(const binary_log_decoder &) = delete;
+
+    // read the next message, with its payload formatted. its string views are valid until the next call.
+    // return false at the end of the input. damaged parts of the input are skipped (see skipped_bytes()).
+    // throw spdlog_ex if the file version is not supported.
+    bool next(log_msg &msg);
+
+    // the pid of the process that wrote the last message read (0 - unknown, version 1 files)
+    size_t pid() const;
+
+    // number of bytes skipped so far, over damaged entries
+    size_t skipped_bytes() const;
+
+private:
+    // read an entry. return true if it is a record, read into msg.
+    bool read_entry_(int tag, log_msg &msg);
+    // skip the first byte of the current entry, and read the others again, looking for a header
+    void skip_damaged_(size_t skipped);
+    // the offset of a header found in the current entry (after its first byte), 0 if none
+    size_t header_in_entry_();
+    // read ahead, so that at least size bytes (if not at the end of the input) are in unread_
+    void peek_(size_t size);
+    // the next byte of the input (EOF at the end), added to the current entry
+    int get_byte_();
+    int read_byte_();
+    unsigned long long read_varint_();
+    void read_bytes_(std::string &dest, size_t size);
+    const std::string *string_at_(unsigned long long id) const;
+
+    std::FILE *in_;
+    std::string entry_;      // the bytes of the entry being read
+    std::string unread_;     // bytes to read again before the input
+    size_t unread_pos_ = 0;  // next byte of unread_
+    bool in_damage_ = false; // skipping to the next header
+    size_t skipped_ = 0;
+    std::deque<std::string> strings_; // by id - 1 (a deque, so the strings never move)
+    log_clock::rep last_time_ = 0;
+    size_t pid_ = 0;
+    std::string bytes_;
+    memory_buf_t payload_;
+    deferred_formatter formatter_;
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "binary_log-inl.h"
@@ -0,0 +1,67 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+namespace spdlog {
+namespace details {
+
+inline pooled_buffer::pooled_buffer()
+    : buf_(&own_buf_)
+{
+    auto *p = thread_buffers_();
+    if (p != nullptr && p->used < pool::max_buffers)
+    {
+        pool_ = p;
+        buf_ = &p->buffers[p->used++];
+    }
+}
+
+inline pooled_buffer::~pooled_buffer()
+{
+    if (pool_ == nullptr)
+    {
+        return;
+    }
+    if (buf_->capacity() > SPDLOG_BUFFER_POOL_MAX_CAPACITY)
+    {
+        *buf_ = memory_buf_t{}; // free the heap memory
+    }
+    else
+    {
+        buf_->clear();
+    }
+    pool_->used--;
+}
+
+inline pooled_buffer::pool::~pool()
+{
+    thread_exiting_() = true;
+}
+
+inline pooled_buffer::pool *pooled_buffer::thread_buffers_()
+{
+#ifdef SPDLOG_NO_TLS
+    return nullptr;
+#else
+    if (thread_exiting_())
+    {
+        return nullptr;
+    }
+    static thread_local pool tls_pool;
+    return &tls_pool;
+#endif
+}
+
+inline bool &pooled_buffer::thread_exiting_()
+{
+#ifdef SPDLOG_NO_TLS
+    static bool exiting = false;
+#else
+    static thread_local bool exiting = false;
+#endif
+    return exiting;
+}
+
+} // namespace details
+} // namespace spdlog
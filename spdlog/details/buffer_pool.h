@@ -0,0 +1,68 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// thread local pool of formatting buffers.
+//
+// the buffers keep the capacity they grew to between the calls, so messages
+// larger than the inline storage of memory_buf_t don't allocate each time.
+// buffers that grew over SPDLOG_BUFFER_POOL_MAX_CAPACITY are freed after use,
+// so one huge message doesn't pin its memory for the life of the thread.
+//
+// usage:
+//    details::pooled_buffer buf;
+//    formatter_->format(msg, buf.get());
+
+#include <spdlog/common.h>
+
+#ifndef SPDLOG_BUFFER_POOL_MAX_CAPACITY
+#define SPDLOG_BUFFER_POOL_MAX_CAPACITY (64 * 1024)
+#endif
+
+namespace spdlog {
+namespace details {
+
+// borrow an empty buffer from the calling thread's pool for the scope.
+// if the pool is exhausted (nested use) or unavailable (SPDLOG_NO_TLS, thread exiting),
+// a buffer of its own is used instead.
+class pooled_buffer
+{
+public:
+    pooled_buffer();
+    ~pooled_buffer();
+
+    pooled_buffer(const pooled_buffer &) = delete;
+    pooled_buffer &operator=(const pooled_buffer &) = delete;
+
+    memory_buf_t &get()
+    {
+        return *buf_;
+    }
+
+private:
+    struct pool
+    {
+        // payload, sinks, and a few more levels of nesting (e.g. sinks that log)
+        static const size_t max_buffers = 4;
+
+        memory_buf_t buffers[max_buffers];
+        size_t used = 0;
+
+        ~pool();
+    };
+
+    // return the calling thread's pool, or nullptr if not available
+    static pool *thread_buffers_();
+    // set once the thread's pool was destroyed. trivially destructible, so always safe to read.
+    static bool &thread_exiting_();
+
+    memory_buf_t *buf_;
+    pool *pool_ = nullptr;
+    memory_buf_t own_buf_;
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "buffer_pool-inl.h"
@@ -0,0 +1,311 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Deferred formatting support (see async_logger::set_deferred_formatting(..)).
+// The format string and the arguments are captured by value into a self
+// describing byte sequence, which is formatted later on another thread:
+//
+//   [format string size][format string chars] then for each argument:
+//   [tag][value bytes] - strings are [tag][size][chars]
+//
+// Values are stored in the native byte order and sizes - the captured bytes
+// are meant to be read back on the same platform.
+//
+// Only arithmetic types and strings are captured. Calls with other argument
+// types are not captured (encode_deferred(..) returns false), and should be
+// formatted right away.
+
+#include <spdlog/common.h>
+#include <spdlog/fmt/args.h>
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+namespace spdlog {
+namespace details {
+namespace deferred {
+
+enum class arg_tag : unsigned char
+{
+    int64,
+    uint64,
+    bool_,
+    char_,
+    float_,
+    double_,
+    long_double,
+    string,
+    null_cstring,
+    pointer
+};
+
+template<typename T>
+struct is_capturable
+    : std::integral_constant<bool, (std::is_integral<T>::value && sizeof(T) <= sizeof(long long) && !std::is_same<T, wchar_t>::value &&
+                                       !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value) ||
+                                       std::is_floating_point<T>::value || std::is_same<T, const char *>::value ||
+                                       std::is_same<T, char *>::value || std::is_same<T, std::string>::value ||
+                                       std::is_same<T, string_view_t>::value || std::is_same<T, const void *>::value ||
+                                       std::is_same<T, void *>::value>
+{};
+
+template<typename... Args>
+struct all_capturable : std::true_type
+{};
+
+template<typename T, typename... Args>
+struct all_capturable<T, Args...>
+    : std::integral_constant<bool, is_capturable<typename std::decay<T>::type>::value && all_capturable<Args...>::value>
+{};
+
+template<typename T>
+inline void append_raw(memory_buf_t &buf, const T &value)
+{
+    const char *p = reinterpret_cast<const char *>(&value);
+    buf.append(p, p + sizeof(T));
+}
+
+inline void append_tag(memory_buf_t &buf, arg_tag tag)
+{
+    buf.push_back(static_cast<char>(tag));
+}
+
+inline void append_string(memory_buf_t &buf, const char *data, size_t size)
+{
+    append_tag(buf, arg_tag::string);
+    append_raw(buf, size);
+    buf.append(data, data + size);
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+inline void encode_arg(memory_buf_t &buf, T value)
+{
+    append_tag(buf, arg_tag::int64);
+    append_raw(buf, static_cast<long long>(value));
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+inline void encode_arg(memory_buf_t &buf, T value)
+{
+    append_tag(buf, arg_tag::uint64);
+    append_raw(buf, static_cast<unsigned long long>(value));
+}
+
+// the overloads below are preferred to the integral templates above
+
+inline void encode_arg(memory_buf_t &buf, bool value)
+{
+    append_tag(buf, arg_tag::bool_);
+    append_raw(buf, value);
+}
+
+inline void encode_arg(memory_buf_t &buf, char value)
+{
+    append_tag(buf, arg_tag::char_);
+    append_raw(buf, value);
+}
+
+inline void encode_arg(memory_buf_t &buf, float value)
+{
+    append_tag(buf, arg_tag::float_);
+    append_raw(buf, value);
+}
+
+inline void encode_arg(memory_buf_t &buf, double value)
+{
+    append_tag(buf, arg_tag::double_);
+    append_raw(buf, value);
+}
+
+inline void encode_arg(memory_buf_t &buf, long double value)
+{
+    append_tag(buf, arg_tag::long_double);
+    append_raw(buf, value);
+}
+
+inline void encode_arg(memory_buf_t &buf, const char *value)
+{
+    if (value == nullptr)
+    {
+        append_tag(buf, arg_tag::null_cstring);
+        return;
+    }
+    append_string(buf, value, std::strlen(value));
+}
+
+inline void encode_arg(memory_buf_t &buf, const std::string &value)
+{
+    append_string(buf, value.data(), value.size());
+}
+
+inline void encode_arg(memory_buf_t &buf, string_view_t value)
+{
+    append_string(buf, value.data(), value.size());
+}
+
+inline void encode_arg(memory_buf_t &buf, const void *value)
+{
+    append_tag(buf, arg_tag::pointer);
+    append_raw(buf, value);
+}
+
+inline void encode_args(memory_buf_t &) {}
+
+template<typename T, typename... Args>
+inline void encode_args(memory_buf_t &buf, const T &arg, const Args &... args)
+{
+    encode_arg(buf, arg);
+    encode_args(buf, args...);
+}
+
+template<typename... Args>
+inline bool encode_deferred(std::false_type, memory_buf_t &, string_view_t, const Args &...)
+{
+    return false;
+}
+
+template<typename... Args>
+inline bool encode_deferred(std::true_type, memory_buf_t &buf, string_view_t fmt, const Args &... args)
+{
+    append_raw(buf, fmt.size());
+    buf.append(fmt.data(), fmt.data() + fmt.size());
+    encode_args(buf, args...);
+    return true;
+}
+
+} // namespace deferred
+
+// capture the format string and the arguments into buf.
+// return false (and leave buf untouched) if some argument cannot be captured.
+template<typename... Args>
+inline bool encode_deferred(memory_buf_t &buf, string_view_t fmt, const Args &... args)
+{
+#ifdef SPDLOG_USE_STD_FORMAT
+    // std::format has no runtime built argument lists
+    return deferred::encode_deferred(std::false_type{}, buf, fmt, args...);
+#else
+    return deferred::encode_deferred(deferred::all_capturable<Args...>{}, buf, fmt, args...);
+#endif
+}
+
+// split what encode_deferred(..) captured into the format string and the encoded arguments
+inline void split_deferred(string_view_t encoded, string_view_t &fmt, string_view_t &args)
+{
+    size_t fmt_size = 0;
+    if (encoded.size() >= sizeof(size_t))
+    {
+        std::memcpy(&fmt_size, encoded.data(), sizeof(size_t));
+    }
+    if (encoded.size() < sizeof(size_t) || fmt_size > encoded.size() - sizeof(size_t))
+    {
+        throw_spdlog_ex("deferred formatting: corrupted arguments");
+    }
+    fmt = string_view_t{encoded.data() + sizeof(size_t), fmt_size};
+    size_t args_offset = sizeof(size_t) + fmt_size;
+    args = string_view_t{encoded.data() + args_offset, encoded.size() - args_offset};
+}
+
+// formats messages captured by encode_deferred(..).
+// the argument list is kept between calls, so its memory is reused.
+class deferred_formatter
+{
+public:
+    void format(string_view_t encoded, memory_buf_t &dest)
+    {
+        string_view_t fmt, args;
+        split_deferred(encoded, fmt, args);
+        format(fmt, args, dest);
+    }
+
+    void format(string_view_t fmt, string_view_t args, memory_buf_t &dest)
+    {
+#ifdef SPDLOG_USE_STD_FORMAT
+        (void)fmt;
+        (void)args;
+        (void)dest;
+        throw_spdlog_ex("deferred formatting is not supported with std::format");
+#else
+        const char *p = args.data();
+        const char *end = p + args.size();
+
+        store_.clear();
+        while (p < end)
+        {
+            auto tag = static_cast<deferred::arg_tag>(*p++);
+            switch (tag)
+            {
+            case deferred::arg_tag::int64:
+                store_.push_back(read_<long long>(p, end));
+                break;
+            case deferred::arg_tag::uint64:
+                store_.push_back(read_<unsigned long long>(p, end));
+                break;
+            case deferred::arg_tag::bool_:
+                store_.push_back(read_<bool>(p, end));
+                break;
+            case deferred::arg_tag::char_:
+                store_.push_back(read_<char>(p, end));
+                break;
+            case deferred::arg_tag::float_:
+                store_.push_back(read_<float>(p, end));
+                break;
+            case deferred::arg_tag::double_:
+                store_.push_back(read_<double>(p, end));
+                break;
+            case deferred::arg_tag::long_double:
+                store_.push_back(read_<long double>(p, end));
+                break;
+            case deferred::arg_tag::string: {
+                size_t size = read_<size_t>(p, end);
+                // a view into encoded - not copied by the store
+                if (size > static_cast<size_t>(end - p))
+                {
+                    throw_spdlog_ex("deferred formatting: corrupted arguments");
+                }
+                store_.push_back(string_view_t{p, size});
+                p += size;
+                break;
+            }
+            case deferred::arg_tag::null_cstring: {
+                // fails the formatting, as it does when formatted right away.
+                // by reference - the store would copy a c string.
+                static const char *const null_cstring = nullptr;
+                store_.push_back(std::cref(null_cstring));
+                break;
+            }
+            case deferred::arg_tag::pointer:
+                store_.push_back(read_<const void *>(p, end));
+                break;
+            default:
+                throw_spdlog_ex("deferred formatting: corrupted arguments");
+            }
+        }
+        fmt::detail::vformat_to(dest, fmt, fmt::format_args(store_));
+#endif
+    }
+
+private:
+    template<typename T>
+    static T read_(const char *&p, const char *end)
+    {
+        if (sizeof(T) > static_cast<size_t>(end - p))
+        {
+            throw_spdlog_ex("deferred formatting: corrupted arguments");
+        }
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+#ifndef SPDLOG_USE_STD_FORMAT
+    fmt::dynamic_format_arg_store<fmt::format_context> store_;
+#endif
+};
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,305 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// multi producer-multi consumer blocking queue that grows and shrinks.
+// items are stored in fixed size segments. the queue starts with a single
+// segment and takes more of them during bursts, up to max_items items.
+// drained segments are kept as spares for the next burst, and freed once no
+// burst was seen for shrink_after.
+//
+// enqueue(..) - will block until room found to put the new message.
+// enqueue_nowait(..) - will overrun the oldest message in the queue if no room left.
+// try_enqueue(..) - will return false if no room left.
+// dequeue_for(..) - will block until the queue is not empty or timeout have
+// passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but pops up to max_items
+// messages under a single lock.
+// try_dequeue_bulk(..) - pops up to max_items messages without waiting.
+//
+// the condition variables are notified (under the lock, which mingw needs)
+// only if some thread is actually parked on them.
+//
+// on_overrun (optional) is called with each item overrun by enqueue_nowait(..),
+// under the queue lock, before the item is discarded.
+
+#include <spdlog/common.h>
+#include <spdlog/details/spin_wait.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+
+template<typename T>
+class elastic_queue
+{
+public:
+    using item_type = T;
+
+    elastic_queue(size_t max_items, spin_wait spin, size_t segment_items, std::chrono::milliseconds shrink_after,
+        std::function<void(T &)> on_overrun = nullptr)
+        : spin_(spin)
+        , on_overrun_(std::move(on_overrun))
+        , max_items_(max_items)
+        , segment_items_(segment_items)
+        , shrink_after_(shrink_after)
+    {
+        segments_.push_back(details::make_unique<segment>(segment_items_));
+    }
+
+    elastic_queue(const elastic_queue &) = delete;
+    elastic_queue &operator=(const elastic_queue &) = delete;
+
+    // try to enqueue and block if no room left
+    void enqueue(T &&item)
+    {
+        if (spin_.until([this, &item] { return this->try_enqueue_(item, std::try_to_lock); }))
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        waiting_producers_++;
+        pop_cv_.wait(lock, [this] { return this->size_ < this->max_items_; });
+        waiting_producers_--;
+        push_back_(item);
+    }
+
+    // enqueue immediately. overrun oldest message in the queue if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (size_ >= max_items_)
+        {
+            if (on_overrun_)
+            {
+                on_overrun_(segments_.front()->items[head_]);
+            }
+            pop_front_(nullptr);
+            overrun_counter_++;
+        }
+        push_back_(item);
+    }
+
+    // enqueue if there is room. Return true, if succeeded
+    bool try_enqueue(T &&item)
+    {
+        return try_enqueue_(item, std::defer_lock);
+    }
+
+    // try to dequeue item. if no item found. wait up to timeout and try again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        return dequeue_bulk_for(&popped_item, 1, wait_duration) == 1;
+    }
+
+    // try to dequeue up to max_items items. if no item found. wait up to timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        size_t n = 0;
+        if (spin_.until([this, popped_items, max_items, &n] {
+                std::unique_lock<std::mutex> lock(this->queue_mutex_, std::try_to_lock);
+                return lock.owns_lock() && (n = this->pop_bulk_(popped_items, max_items)) > 0;
+            }))
+        {
+            return n;
+        }
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        waiting_consumers_++;
+        bool not_empty = push_cv_.wait_for(lock, wait_duration, [this] { return this->size_ > 0; });
+        waiting_consumers_--;
+        if (!not_empty)
+        {
+            // idle - good time to give back the spare segments
+            shrink_();
+            return 0;
+        }
+        return pop_bulk_(popped_items, max_items);
+    }
+
+    // dequeue up to max_items items without waiting
+    // Return the number of dequeued items
+    size_t try_dequeue_bulk(T *popped_items, size_t max_items)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        return pop_bulk_(popped_items, max_items);
+    }
+
+    size_t overrun_counter()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        return overrun_counter_;
+    }
+
+    size_t size()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        return size_;
+    }
+
+    void reset_overrun_counter()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        overrun_counter_ = 0;
+    }
+
+    // number of segments currently allocated (in use and spare)
+    size_t segments()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        return segments_.size() + spare_.size();
+    }
+
+private:
+    struct segment
+    {
+        explicit segment(size_t n)
+            : items(n)
+        {}
+        std::vector<T> items;
+    };
+
+    // LockTag is std::try_to_lock (give up if the lock is busy, while spinning) or std::defer_lock (wait for the lock)
+    template<typename LockTag>
+    bool try_enqueue_(T &item, LockTag tag)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_, tag);
+        if (!lock.owns_lock())
+        {
+            if (std::is_same<LockTag, std::try_to_lock_t>::value)
+            {
+                return false;
+            }
+            lock.lock();
+        }
+        if (size_ >= max_items_)
+        {
+            return false;
+        }
+        push_back_(item);
+        return true;
+    }
+
+    // the functions below must be called under the lock
+    void push_back_(T &item)
+    {
+        if (tail_ == segment_items_)
+        {
+            segments_.push_back(take_segment_());
+            tail_ = 0;
+        }
+        segments_.back()->items[tail_++] = std::move(item);
+        size_++;
+        if (waiting_consumers_ > 0)
+        {
+            push_cv_.notify_one();
+        }
+    }
+
+    // pass nullptr to drop the item
+    void pop_front_(T *popped_item)
+    {
+        auto &front = segments_.front()->items[head_++];
+        if (popped_item != nullptr)
+        {
+            *popped_item = std::move(front);
+        }
+        size_--;
+
+        if (segments_.size() == 1)
+        {
+            // rewind the only segment whenever it gets empty
+            if (size_ == 0)
+            {
+                head_ = tail_ = 0;
+            }
+        }
+        else if (head_ == segment_items_)
+        {
+            spare_.push_back(std::move(segments_.front()));
+            segments_.pop_front();
+            head_ = 0;
+            shrink_();
+        }
+    }
+
+    size_t pop_bulk_(T *popped_items, size_t max_items)
+    {
+        size_t n = 0;
+        while (n < max_items && size_ > 0)
+        {
+            pop_front_(&popped_items[n++]);
+        }
+        if (n > 0 && waiting_producers_ > 0)
+        {
+            if (n > 1)
+            {
+                pop_cv_.notify_all();
+            }
+            else
+            {
+                pop_cv_.notify_one();
+            }
+        }
+        return n;
+    }
+
+    std::unique_ptr<segment> take_segment_()
+    {
+        // more than a segment of backlog - we are in a burst
+        if (size_ >= segment_items_)
+        {
+            last_burst_ = std::chrono::steady_clock::now();
+        }
+        if (spare_.empty())
+        {
+            return details::make_unique<segment>(segment_items_);
+        }
+        auto s = std::move(spare_.back());
+        spare_.pop_back();
+        return s;
+    }
+
+    // free the spare segments if no burst was seen for a while.
+    // one spare is kept, since it is reused on every wrap of a segment.
+    void shrink_()
+    {
+        if (spare_.size() > 1 && std::chrono::steady_clock::now() - last_burst_ > shrink_after_)
+        {
+            spare_.resize(1);
+            spare_.shrink_to_fit();
+        }
+    }
+
+    const spin_wait spin_;
+    const std::function<void(T &)> on_overrun_;
+    const size_t max_items_;
+    const size_t segment_items_;
+    const std::chrono::milliseconds shrink_after_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable push_cv_;
+    std::condition_variable pop_cv_;
+    size_t waiting_consumers_ = 0;
+    size_t waiting_producers_ = 0;
+
+    std::deque<std::unique_ptr<segment>> segments_; // head segment first
+    std::vector<std::unique_ptr<segment>> spare_;
+    size_t head_ = 0; // next item to pop in the first segment
+    size_t tail_ = 0; // next free slot in the last segment
+    size_t size_ = 0;
+    size_t overrun_counter_ = 0;
+    std::chrono::steady_clock::time_point last_burst_;
+};
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,249 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+#include <spdlog/common.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace spdlog {
+namespace details {
+
+template<size_t BufferSize>
+inline fd_file_helper<BufferSize>::fd_file_helper(const file_event_handlers &event_handlers)
+    : event_handlers_(event_handlers)
+{}
+
+template<size_t BufferSize>
+inline fd_file_helper<BufferSize>::~fd_file_helper()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // the buffered messages are lost - nothing else to do in a destructor
+    }
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::open(const filename_t &fname, bool truncate)
+{
+    close();
+    filename_ = fname;
+
+    if (event_handlers_.before_open)
+    {
+        event_handlers_.before_open(filename_);
+    }
+    for (int tries = 0; tries < open_tries_; ++tries)
+    {
+        // create containing folder if not exists already.
+        os::create_dir(os::dir_name(fname));
+        if (truncate)
+        {
+            // Truncate by opening-and-closing first, always opening the actual
+            // log-we-write-to in append mode (see file_helper::open(..)).
+            int tmp = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (tmp == -1)
+            {
+                continue;
+            }
+            ::close(tmp);
+        }
+        fd_ = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ != -1)
+        {
+            if (!buffer_)
+            {
+                buffer_.reset(new char[BufferSize]);
+            }
+            call_handler_(event_handlers_.after_open);
+            return;
+        }
+
+        details::os::sleep_for_millis(open_interval_);
+    }
+
+    throw_spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", errno);
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::reopen(bool truncate)
+{
+    if (filename_.empty())
+    {
+        throw_spdlog_ex("Failed re opening file - was not opened before");
+    }
+    this->open(filename_, truncate);
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::flush()
+{
+    if (buffered_ > 0)
+    {
+        write_out_(nullptr, 0);
+    }
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::close()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+
+    // close the file even if the buffer cannot be written, and report the error after
+    std::string write_error;
+    try
+    {
+        flush();
+    }
+    catch (const spdlog_ex &ex)
+    {
+        write_error = ex.what();
+        buffered_ = 0;
+    }
+
+    call_handler_(event_handlers_.before_close);
+    ::close(fd_);
+    fd_ = -1;
+
+    if (event_handlers_.after_close)
+    {
+        event_handlers_.after_close(filename_);
+    }
+
+    if (!write_error.empty())
+    {
+        throw_spdlog_ex(write_error);
+    }
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::write(const memory_buf_t &buf)
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot write to closed file " + os::filename_to_str(filename_));
+    }
+    size_t msg_size = buf.size();
+    if (buffered_ + msg_size <= BufferSize)
+    {
+        std::memcpy(buffer_.get() + buffered_, buf.data(), msg_size);
+        buffered_ += msg_size;
+        return;
+    }
+    write_out_(buf.data(), msg_size);
+}
+
+template<size_t BufferSize>
+inline size_t fd_file_helper<BufferSize>::size() const
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(filename_));
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        throw_spdlog_ex("Failed getting file size. fd=" + std::to_string(fd_), errno);
+    }
+    return static_cast<size_t>(st.st_size) + buffered_;
+}
+
+template<size_t BufferSize>
+inline const filename_t &fd_file_helper<BufferSize>::filename() const
+{
+    return filename_;
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::write_out_(const char *data, size_t size)
+{
+    struct iovec iov[2];
+    iov[0].iov_base = buffer_.get();
+    iov[0].iov_len = buffered_;
+    iov[1].iov_base = const_cast<char *>(data);
+    iov[1].iov_len = size;
+    struct iovec *pending = buffered_ > 0 ? iov : iov + 1;
+    int pending_count = buffered_ > 0 ? (size > 0 ? 2 : 1) : 1;
+
+    while (pending_count > 0)
+    {
+        ssize_t written = ::writev(fd_, pending, pending_count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // keep what was not written of the buffer, for the next try (the message failed)
+            int write_errno = errno;
+            size_t buffer_left = pending == iov ? iov[0].iov_len : 0;
+            std::memmove(buffer_.get(), buffer_.get() + (buffered_ - buffer_left), buffer_left);
+            buffered_ = buffer_left;
+            throw_spdlog_ex("Failed writing to file " + os::filename_to_str(filename_), write_errno);
+        }
+
+        // partial write - skip what was written and try again
+        auto remaining = static_cast<size_t>(written);
+        while (pending_count > 0 && remaining >= pending->iov_len)
+        {
+            remaining -= pending->iov_len;
+            ++pending;
+            --pending_count;
+        }
+        if (pending_count > 0)
+        {
+            pending->iov_base = static_cast<char *>(pending->iov_base) + remaining;
+            pending->iov_len -= remaining;
+        }
+    }
+    buffered_ = 0;
+}
+
+template<size_t BufferSize>
+inline void fd_file_helper<BufferSize>::call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler)
+{
+    if (!handler)
+    {
+        return;
+    }
+    int dup_fd = ::fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    std::FILE *stream = dup_fd != -1 ? ::fdopen(dup_fd, "ab") : nullptr;
+    if (stream == nullptr)
+    {
+        if (dup_fd != -1)
+        {
+            ::close(dup_fd);
+        }
+        throw_spdlog_ex("Failed opening a stream for the event handler of " + os::filename_to_str(filename_), errno);
+    }
+    try
+    {
+        handler(filename_, stream);
+    }
+    catch (...)
+    {
+        std::fclose(stream);
+        throw;
+    }
+    std::fclose(stream);
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,69 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <memory>
+
+#ifndef SPDLOG_FD_FILE_BUFFER_SIZE
+#define SPDLOG_FD_FILE_BUFFER_SIZE (256 * 1024)
+#endif
+
+namespace spdlog {
+namespace details {
+
+// Alternative to file_helper for the file sinks, e.g.
+//    sinks::basic_file_sink<std::mutex, details::fd_file_helper<>>
+//    sinks::rotating_file_sink<std::mutex, details::fd_file_helper<4 * 1024 * 1024>>
+//
+// Writes to a raw O_APPEND file descriptor through a user space buffer of BufferSize bytes,
+// instead of stdio (and its per call lock, redundant under the sink's mutex).
+// The buffer is written with a single write()/writev() when full, and on flush() - e.g. when
+// the logger's flush level is reached, or periodically with spdlog::flush_every(..).
+// Messages are lost if the process crashes before the buffer is written.
+//
+// The event handlers get a FILE* over a duplicate of the descriptor, which is closed right after
+// the handler returns (so what the handler writes goes to the file right away).
+// When failing to open a file, retry several times(5) with a delay interval(10 ms).
+// Throw spdlog_ex exception on errors.
+template<size_t BufferSize = SPDLOG_FD_FILE_BUFFER_SIZE>
+class fd_file_helper
+{
+    static_assert(BufferSize > 0, "BufferSize must be greater than zero");
+
+public:
+    fd_file_helper() = default;
+    explicit fd_file_helper(const file_event_handlers &event_handlers);
+
+    fd_file_helper(const fd_file_helper &) = delete;
+    fd_file_helper &operator=(const fd_file_helper &) = delete;
+    ~fd_file_helper();
+
+    void open(const filename_t &fname, bool truncate = false);
+    void reopen(bool truncate);
+    void flush();
+    void close();
+    void write(const memory_buf_t &buf);
+    // the size of the file, including what is still buffered
+    size_t size() const;
+    const filename_t &filename() const;
+
+private:
+    // write the buffer, followed by size bytes of data (if any), then empty the buffer
+    void write_out_(const char *data, size_t size);
+    void call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler);
+
+    const int open_tries_ = 5;
+    const unsigned int open_interval_ = 10;
+    int fd_ = -1;
+    std::unique_ptr<char[]> buffer_;
+    size_t buffered_ = 0;
+    filename_t filename_;
+    file_event_handlers event_handlers_;
+};
+} // namespace details
+} // namespace spdlog
+
+#include "fd_file_helper-inl.h"
@@ -0,0 +1,202 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef SPDLOG_USE_ZLIB
+#    include <unistd.h>
+#    include <zlib.h>
+#endif
+
+namespace spdlog {
+namespace details {
+
+inline file_compressor::file_compressor(file_compression compression, int level)
+    : compression_(compression)
+    , level_(level)
+{
+#ifndef SPDLOG_USE_ZLIB
+    if (compression_ == file_compression::gzip)
+    {
+        throw_spdlog_ex("gzip compression of log files needs SPDLOG_USE_ZLIB");
+    }
+#endif
+    if (level_ < -1 || level_ > 9)
+    {
+        throw_spdlog_ex("file_compressor: invalid compression level");
+    }
+}
+
+inline void file_compressor::compress(const filename_t &filename) const
+{
+    using details::os::filename_to_str;
+
+    if (!enabled())
+    {
+        return;
+    }
+    filename_t target_filename = filename + suffix(compression_);
+    filename_t tmp_filename = target_filename + SPDLOG_FILENAME_T(".tmp");
+    try
+    {
+        gzip_(filename, tmp_filename);
+    }
+    catch (...)
+    {
+        (void)os::remove(tmp_filename);
+        throw;
+    }
+    if (os::rename(tmp_filename, target_filename) != 0)
+    {
+        int rename_errno = errno;
+        (void)os::remove(tmp_filename);
+        throw_spdlog_ex("file_compressor: failed renaming " + filename_to_str(tmp_filename) + " to " + filename_to_str(target_filename),
+            rename_errno);
+    }
+    if (os::remove(filename) != 0)
+    {
+        throw_spdlog_ex("file_compressor: failed removing " + filename_to_str(filename), errno);
+    }
+}
+
+inline filename_t file_compressor::suffix(file_compression compression)
+{
+    return compression == file_compression::gzip ? SPDLOG_FILENAME_T(".gz") : filename_t{};
+}
+
+inline bool file_compressor::strip_suffix(filename_t &filename)
+{
+    filename_t gz_suffix = suffix(file_compression::gzip);
+    if (filename.size() > gz_suffix.size() && filename.compare(filename.size() - gz_suffix.size(), gz_suffix.size(), gz_suffix) == 0)
+    {
+        filename.resize(filename.size() - gz_suffix.size());
+        return true;
+    }
+    return false;
+}
+
+inline bool file_compressor::exists(const filename_t &filename)
+{
+    return os::path_exists(filename) || os::path_exists(filename + suffix(file_compression::gzip));
+}
+
+inline int file_compressor::remove_if_exists(const filename_t &filename)
+{
+    int rv = os::remove_if_exists(filename);
+    int remove_errno = errno;
+    if (os::remove_if_exists(filename + suffix(file_compression::gzip)) != 0)
+    {
+        return -1;
+    }
+    errno = remove_errno; // of the first failure, for the caller
+    return rv;
+}
+
+// the source replaces the target - whatever versions of the target exist are deleted first.
+inline int file_compressor::rename(const filename_t &src_filename, const filename_t &target_filename)
+{
+    (void)remove_if_exists(target_filename);
+    int rv = 0;
+    filename_t gz_suffix = suffix(file_compression::gzip);
+    for (const filename_t &sfx : {filename_t{}, gz_suffix})
+    {
+        if (os::path_exists(src_filename + sfx) && os::rename(src_filename + sfx, target_filename + sfx) != 0)
+        {
+            rv = -1;
+        }
+    }
+    return rv;
+}
+
+inline void file_compressor::gzip_(const filename_t &src_filename, const filename_t &target_filename) const
+{
+    using details::os::filename_to_str;
+
+#ifdef SPDLOG_USE_ZLIB
+    std::FILE *in = std::fopen(src_filename.c_str(), "rb");
+    if (in == nullptr)
+    {
+        throw_spdlog_ex("file_compressor: failed opening " + filename_to_str(src_filename), errno);
+    }
+    std::FILE *out = nullptr;
+    if (os::fopen_s(&out, target_filename, SPDLOG_FILENAME_T("wb")))
+    {
+        int open_errno = errno;
+        std::fclose(in);
+        throw_spdlog_ex("file_compressor: failed opening " + filename_to_str(target_filename), open_errno);
+    }
+
+    z_stream stream{};
+    // 15 + 16: the largest window, with a gzip header and trailer
+    if (deflateInit2(&stream, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        std::fclose(in);
+        std::fclose(out);
+        throw_spdlog_ex("file_compressor: deflateInit2 failed");
+    }
+
+    const size_t chunk_size = 64 * 1024;
+    std::vector<unsigned char> in_buf(chunk_size), out_buf(chunk_size);
+    std::string err; // cleanup first, then throw
+    int err_errno = 0;
+    int flush = Z_NO_FLUSH;
+    while (err.empty() && flush != Z_FINISH)
+    {
+        size_t n_read = std::fread(in_buf.data(), 1, chunk_size, in);
+        if (std::ferror(in))
+        {
+            err = "file_compressor: failed reading " + filename_to_str(src_filename);
+            err_errno = errno;
+            break;
+        }
+        flush = std::feof(in) ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = in_buf.data();
+        stream.avail_in = static_cast<uInt>(n_read);
+        do
+        {
+            stream.next_out = out_buf.data();
+            stream.avail_out = static_cast<uInt>(chunk_size);
+            deflate(&stream, flush); // no error possible here, see zlib.h
+            size_t n_out = chunk_size - stream.avail_out;
+            if (std::fwrite(out_buf.data(), 1, n_out, out) != n_out)
+            {
+                err = "file_compressor: failed writing " + filename_to_str(target_filename);
+                err_errno = errno;
+                break;
+            }
+        } while (stream.avail_out == 0);
+    }
+    deflateEnd(&stream);
+    std::fclose(in);
+
+    // on disk before it replaces the original
+    if (err.empty() && (std::fflush(out) != 0 || ::fsync(::fileno(out)) != 0))
+    {
+        err = "file_compressor: failed flushing " + filename_to_str(target_filename);
+        err_errno = errno;
+    }
+    if (std::fclose(out) != 0 && err.empty())
+    {
+        err = "file_compressor: failed closing " + filename_to_str(target_filename);
+        err_errno = errno;
+    }
+    if (!err.empty())
+    {
+        throw_spdlog_ex(err, err_errno);
+    }
+#else
+    (void)src_filename;
+    (void)target_filename;
+    throw_spdlog_ex("gzip compression of log files needs SPDLOG_USE_ZLIB");
+#endif
+}
+
+} // namespace details
+} // namespace spdlog
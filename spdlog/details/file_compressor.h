@@ -0,0 +1,64 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Compresses the rotated files of the file sinks (see file_compression).
+// The sinks run it on their housekeeper's thread (see details::file_housekeeper), never on the
+// logging path. The sinks without a housekeeper of their own share file_housekeeper::shared(),
+// so a single core at most is spent compressing for them all.
+
+#include <spdlog/common.h>
+
+namespace spdlog {
+namespace details {
+
+class file_compressor
+{
+public:
+    file_compressor() = default;
+
+    // level - 1 (fastest) to 9 (smallest), or -1 for the default of the library.
+    // throw spdlog_ex if the compression is not available in this build.
+    explicit file_compressor(file_compression compression, int level = -1);
+
+    bool enabled() const
+    {
+        return compression_ != file_compression::none;
+    }
+
+    // compress the file into the file name + suffix (e.g. log.1.txt.gz), then remove it.
+    // the compressed file is written under a temporary name and renamed when complete,
+    // so there is always either the file or its complete compressed version.
+    // throw spdlog_ex on failure, leaving the file as is.
+    void compress(const filename_t &filename) const;
+
+    // the suffix of the compressed files (e.g. ".gz"). empty for file_compression::none
+    static filename_t suffix(file_compression compression);
+
+    // remove the compression suffix from the given file name, if it has any known one.
+    // return true if it had.
+    static bool strip_suffix(filename_t &filename);
+
+    // true if the file exists, as is or compressed
+    static bool exists(const filename_t &filename);
+
+    // delete the file and its compressed versions, if they exist.
+    // return 0 on success.
+    static int remove_if_exists(const filename_t &filename);
+
+    // rename the file and its compressed versions which exist (e.g. log.1.txt.gz -> log.2.txt.gz).
+    // return 0 on success.
+    static int rename(const filename_t &src_filename, const filename_t &target_filename);
+
+private:
+    void gzip_(const filename_t &src_filename, const filename_t &target_filename) const;
+
+    file_compression compression_ = file_compression::none;
+    int level_ = -1;
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "file_compressor-inl.h"
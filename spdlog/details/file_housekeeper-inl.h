@@ -0,0 +1,131 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+#include <spdlog/details/registry.h>
+
+#include <cstdio>
+#include <exception>
+
+#include <sys/resource.h>
+
+namespace spdlog {
+namespace details {
+
+inline file_housekeeper::file_housekeeper(err_handler handler)
+    : err_handler_(std::move(handler))
+    , worker_thread_(&file_housekeeper::worker_loop_, this)
+{}
+
+// run the pending tasks, then stop the worker thread and join it
+inline file_housekeeper::~file_housekeeper()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_ = false;
+    }
+    cv_.notify_one();
+    worker_thread_.join();
+}
+
+inline void file_housekeeper::set_error_handler(err_handler handler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    err_handler_ = std::move(handler);
+}
+
+// held by the sinks only - the thread stops when the last of them is destroyed
+inline std::shared_ptr<file_housekeeper> file_housekeeper::shared()
+{
+    static std::mutex mutex;
+    static std::weak_ptr<file_housekeeper> instance;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto housekeeper = instance.lock();
+    if (!housekeeper)
+    {
+        housekeeper = std::make_shared<file_housekeeper>();
+        instance = housekeeper;
+    }
+    return housekeeper;
+}
+
+inline void file_housekeeper::post(std::function<void()> task)
+{
+    err_handler global_handler = registry::instance().get_error_handler();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace_back(std::move(task), std::move(global_handler));
+    }
+    cv_.notify_one();
+}
+
+inline void file_housekeeper::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return this->tasks_.empty() && !this->busy_; });
+}
+
+inline void file_housekeeper::worker_loop_()
+{
+    // the lowest priority (of this thread only), so the work (e.g. compressing files) takes
+    // the cpu from the logging threads only when they leave it idle. best effort.
+    (void)::setpriority(PRIO_PROCESS, static_cast<id_t>(os::_thread_id()), 19);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        cv_.wait(lock, [this] { return !this->tasks_.empty() || !this->active_; });
+        if (tasks_.empty())
+        {
+            return; // active_ == false and nothing left to do, so exit this thread
+        }
+        auto task = std::move(tasks_.front().first);
+        auto global_handler = std::move(tasks_.front().second);
+        tasks_.pop_front();
+        busy_ = true;
+        lock.unlock();
+        try
+        {
+            task();
+        }
+        catch (const std::exception &ex)
+        {
+            report_(ex.what(), global_handler);
+        }
+        catch (...)
+        {
+            report_("Unknown exception in file housekeeper", global_handler);
+        }
+        task = nullptr; // release what the task holds (e.g. the rotated file) before going idle
+        lock.lock();
+        busy_ = false;
+        if (tasks_.empty())
+        {
+            idle_cv_.notify_all();
+        }
+    }
+}
+
+inline void file_housekeeper::report_(const std::string &msg, const err_handler &global_handler)
+{
+    err_handler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handler = err_handler_ ? err_handler_ : global_handler;
+    }
+    if (handler)
+    {
+        handler(msg);
+        return;
+    }
+
+    auto tm_time = os::localtime();
+    char date_buf[64];
+    std::strftime(date_buf, sizeof(date_buf), "%Y-%m-%d %H:%M:%S", &tm_time);
+    std::fprintf(stderr, "[*** LOG ERROR ***] [%s] [file housekeeper] {%s}\n", date_buf, msg.c_str());
+}
+
+} // namespace details
+} // namespace spdlog
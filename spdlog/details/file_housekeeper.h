@@ -0,0 +1,70 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// file housekeeper - a worker thread for the slow filesystem work of the file sinks
+// (closing the rotated files, renaming and deleting the old ones), so the message that
+// triggers a rotation only pays for opening the new file.
+// see set_housekeeper(..) of the rotating, daily and hourly file sinks.
+//
+// the tasks run one at a time, in the order they were posted, at the lowest thread priority (nice 19).
+// failures (exceptions thrown by a task) are reported to the error handler - the housekeeper's own if set,
+// else the one of spdlog::set_error_handler(..) when the task was posted, else printed to stderr.
+// to report to a logger's handler: housekeeper->set_error_handler([logger](const std::string &msg) { ... }).
+//
+// RAII over the owned thread:
+//    creates the thread on construction.
+//    runs the pending tasks, then stops and joins the thread on destruction.
+
+#include <spdlog/common.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace spdlog {
+namespace details {
+
+class file_housekeeper
+{
+public:
+    explicit file_housekeeper(err_handler handler = nullptr);
+    file_housekeeper(const file_housekeeper &) = delete;
+    file_housekeeper &operator=(const file_housekeeper &) = delete;
+    ~file_housekeeper();
+
+    void set_error_handler(err_handler handler);
+
+    // the housekeeper of the sinks that compress their files and have none set (see set_compression(..) of the sinks).
+    // one thread for them all, so no more than one file is compressed at a time. created on first use.
+    static std::shared_ptr<file_housekeeper> shared();
+
+    void post(std::function<void()> task);
+
+    // block until the tasks posted so far are done
+    void wait();
+
+private:
+    void worker_loop_();
+    void report_(const std::string &msg, const err_handler &global_handler);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    // with the handler of spdlog::set_error_handler(..) at post time (the registry may be gone when they run)
+    std::deque<std::pair<std::function<void()>, err_handler>> tasks_;
+    bool busy_ = false;
+    bool active_ = true;
+    err_handler err_handler_;
+    std::thread worker_thread_;
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "file_housekeeper-inl.h"
@@ -0,0 +1,67 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+namespace spdlog {
+namespace details {
+
+inline size_t formatter_keys::acquire(const std::string &key)
+{
+    if (key.empty())
+    {
+        return 0;
+    }
+    auto &keys = instance();
+    std::lock_guard<std::mutex> lock(keys.mutex_);
+    auto it = keys.entries_.find(key);
+    if (it == keys.entries_.end())
+    {
+        // ids are not reused, so a released id never matches a newer key
+        it = keys.entries_.emplace(key, entry{++keys.last_id_, 0}).first;
+        keys.keys_.emplace(it->second.id, &it->first);
+    }
+    it->second.refs++;
+    return it->second.id;
+}
+
+inline void formatter_keys::release(size_t id)
+{
+    if (id == 0)
+    {
+        return;
+    }
+    auto &keys = instance();
+    std::lock_guard<std::mutex> lock(keys.mutex_);
+    auto key_it = keys.keys_.find(id);
+    if (key_it == keys.keys_.end())
+    {
+        return;
+    }
+    auto it = keys.entries_.find(*key_it->second);
+    if (--it->second.refs == 0)
+    {
+        keys.keys_.erase(key_it);
+        keys.entries_.erase(it);
+    }
+}
+
+inline std::uint32_t formatter_keys::generation()
+{
+    return instance().generation_.load(std::memory_order_acquire);
+}
+
+inline void formatter_keys::bump_generation()
+{
+    instance().generation_.fetch_add(1, std::memory_order_release);
+}
+
+// leaked, so sinks destroyed during static destruction can still release their keys
+inline formatter_keys &formatter_keys::instance()
+{
+    static formatter_keys *keys = new formatter_keys();
+    return *keys;
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,62 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// process wide table of the formatter keys in use by the sinks (see formatter::key()).
+//
+// each distinct key gets a distinct non zero id, so the sinks compare their keys
+// by id without a lock. refcounted - a key is forgotten once no sink holds its id,
+// so the table holds only the keys of the current formatters.
+// the lock is taken only when a sink's formatter changes, never to log.
+// the generation counts the changes of the keys held by the sinks, so loggers
+// know when to regroup their sinks by key (see logger::shared_sinks_()).
+
+#include <spdlog/common.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace spdlog {
+namespace details {
+
+class formatter_keys
+{
+public:
+    formatter_keys(const formatter_keys &) = delete;
+    formatter_keys &operator=(const formatter_keys &) = delete;
+
+    // the id of key, held until release(..). 0 (and nothing held) for an empty key.
+    static size_t acquire(const std::string &key);
+    // release an id returned by acquire(..). 0 is ignored.
+    static void release(size_t id);
+
+    // changes whenever a sink's key id, or the sinks of a logger, may have changed. never 0 (unless wrapped).
+    static std::uint32_t generation();
+    // call after the change, so whoever sees the new generation sees the change too
+    static void bump_generation();
+
+private:
+    struct entry
+    {
+        size_t id;
+        size_t refs;
+    };
+
+    formatter_keys() = default;
+    static formatter_keys &instance();
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, entry> entries_;
+    std::unordered_map<size_t, const std::string *> keys_; // by id, pointing into entries_
+    size_t last_id_ = 0;
+    std::atomic<std::uint32_t> generation_{1};
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "formatter_keys-inl.h"
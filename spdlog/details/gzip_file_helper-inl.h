@@ -0,0 +1,390 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+#include <spdlog/common.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace spdlog {
+namespace details {
+
+template<int Level>
+inline gzip_file_helper<Level>::gzip_file_helper(const file_event_handlers &event_handlers)
+    : event_handlers_(event_handlers)
+{}
+
+template<int Level>
+inline gzip_file_helper<Level>::~gzip_file_helper()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // the buffered messages are lost - nothing else to do in a destructor
+    }
+    if (stream_init_)
+    {
+        deflateEnd(&stream_);
+    }
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::open(const filename_t &fname, bool truncate)
+{
+    close();
+    filename_ = fname;
+
+    if (!stream_init_)
+    {
+        // 15 + 16: the largest window, with a gzip header and trailer
+        if (deflateInit2(&stream_, Level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw_spdlog_ex("Failed initializing the compressor for " + os::filename_to_str(filename_));
+        }
+        stream_init_ = true;
+        out_buffer_.reset(new unsigned char[out_buffer_size]);
+    }
+
+    if (event_handlers_.before_open)
+    {
+        event_handlers_.before_open(filename_);
+    }
+    for (int tries = 0; tries < open_tries_; ++tries)
+    {
+        // create containing folder if not exists already.
+        os::create_dir(os::dir_name(fname));
+        if (truncate)
+        {
+            // Truncate by opening-and-closing first, always opening the actual
+            // log-we-write-to in append mode (see file_helper::open(..)).
+            int tmp = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (tmp == -1)
+            {
+                continue;
+            }
+            ::close(tmp);
+        }
+        fd_ = ::open(fname.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ != -1)
+        {
+            // appending to an existing file adds members after its own complete ones
+            struct stat st;
+            file_size_ = ::fstat(fd_, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+            try
+            {
+                size_t recovered_size = file_size_ > 0 ? recover_size_(file_size_) : 0;
+                if (recovered_size != file_size_ && ::ftruncate(fd_, static_cast<off_t>(recovered_size)) != 0)
+                {
+                    throw_spdlog_ex("Failed truncating file " + os::filename_to_str(filename_), errno);
+                }
+                file_size_ = recovered_size;
+            }
+            catch (...)
+            {
+                ::close(fd_);
+                fd_ = -1;
+                throw;
+            }
+            call_handler_(event_handlers_.after_open);
+            return;
+        }
+
+        details::os::sleep_for_millis(open_interval_);
+    }
+
+    throw_spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", errno);
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::reopen(bool truncate)
+{
+    if (filename_.empty())
+    {
+        throw_spdlog_ex("Failed re opening file - was not opened before");
+    }
+    this->open(filename_, truncate);
+}
+
+// end the current member, and write it out
+template<int Level>
+inline void gzip_file_helper<Level>::flush()
+{
+    if (in_member_)
+    {
+        in_member_ = false;
+        try
+        {
+            compress_(nullptr, 0, Z_FINISH);
+        }
+        catch (...)
+        {
+            deflateReset(&stream_);
+            throw;
+        }
+        deflateReset(&stream_);
+    }
+    if (out_size_ > 0)
+    {
+        write_out_();
+    }
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::close()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+
+    call_handler_(event_handlers_.before_close);
+
+    // close the file even if the buffer cannot be written, and report the error after
+    std::string write_error;
+    try
+    {
+        flush();
+    }
+    catch (const spdlog_ex &ex)
+    {
+        write_error = ex.what();
+        out_size_ = 0;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+
+    if (event_handlers_.after_close)
+    {
+        event_handlers_.after_close(filename_);
+    }
+
+    if (!write_error.empty())
+    {
+        throw_spdlog_ex(write_error);
+    }
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::write(const memory_buf_t &buf)
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot write to closed file " + os::filename_to_str(filename_));
+    }
+    compress_(buf.data(), buf.size(), Z_NO_FLUSH);
+}
+
+template<int Level>
+inline size_t gzip_file_helper<Level>::size() const
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(filename_));
+    }
+    return file_size_ + out_size_;
+}
+
+template<int Level>
+inline const filename_t &gzip_file_helper<Level>::filename() const
+{
+    return filename_;
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::compress_(const char *data, size_t size, int flush_mode)
+{
+    if (size > 0)
+    {
+        in_member_ = true;
+    }
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_.avail_in = static_cast<uInt>(size);
+    for (;;)
+    {
+        if (out_size_ == out_buffer_size)
+        {
+            write_out_();
+        }
+        stream_.next_out = out_buffer_.get() + out_size_;
+        stream_.avail_out = static_cast<uInt>(out_buffer_size - out_size_);
+        int rc = deflate(&stream_, flush_mode);
+        out_size_ = out_buffer_size - stream_.avail_out;
+        if (rc == Z_STREAM_ERROR)
+        {
+            throw_spdlog_ex("Failed compressing to file " + os::filename_to_str(filename_));
+        }
+        // done when all the input is taken (and with Z_FINISH, the member's trailer is out)
+        if (flush_mode == Z_FINISH ? rc == Z_STREAM_END : stream_.avail_in == 0 && stream_.avail_out != 0)
+        {
+            return;
+        }
+    }
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::write_out_()
+{
+    size_t offset = 0;
+    while (offset < out_size_)
+    {
+        ssize_t written = ::write(fd_, out_buffer_.get() + offset, out_size_ - offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // keep what was not written, for the next try
+            int write_errno = errno;
+            std::memmove(out_buffer_.get(), out_buffer_.get() + offset, out_size_ - offset);
+            out_size_ -= offset;
+            throw_spdlog_ex("Failed writing to file " + os::filename_to_str(filename_), write_errno);
+        }
+        offset += static_cast<size_t>(written);
+        file_size_ += static_cast<size_t>(written);
+    }
+    out_size_ = 0;
+}
+
+template<int Level>
+inline size_t gzip_file_helper<Level>::recover_size_(size_t file_size)
+{
+    // members can be cut short only at the end of the file - start from the last one
+    size_t start = find_last_member_(file_size);
+    bool own_member = start != file_size;
+    start = own_member ? start : 0;
+
+    z_stream inflater{};
+    // 15 + 16: gzip members only
+    if (inflateInit2(&inflater, 15 + 16) != Z_OK)
+    {
+        throw_spdlog_ex("Failed initializing the decompressor for " + os::filename_to_str(filename_));
+    }
+    std::unique_ptr<unsigned char[]> in_buffer(new unsigned char[out_buffer_size]);
+    size_t read_offset = start;
+    size_t members_end = start; // end of the last complete member
+    int rc = Z_OK;
+    bool output_full = false; // more output may come without more input
+    for (;;)
+    {
+        if (inflater.avail_in == 0 && !output_full)
+        {
+            if (read_offset == file_size)
+            {
+                break; // the end of the file, cut short unless right after a member
+            }
+            ssize_t n = ::pread(fd_, in_buffer.get(), (std::min)(static_cast<size_t>(out_buffer_size), file_size - read_offset), static_cast<off_t>(read_offset));
+            if (n <= 0)
+            {
+                int read_errno = n < 0 ? errno : 0;
+                inflateEnd(&inflater);
+                throw_spdlog_ex("Failed reading file " + os::filename_to_str(filename_), read_errno);
+            }
+            read_offset += static_cast<size_t>(n);
+            inflater.next_in = in_buffer.get();
+            inflater.avail_in = static_cast<uInt>(n);
+        }
+        // the output is not needed
+        inflater.next_out = out_buffer_.get();
+        inflater.avail_out = static_cast<uInt>(out_buffer_size);
+        rc = inflate(&inflater, Z_NO_FLUSH);
+        output_full = inflater.avail_out == 0;
+        if (rc == Z_STREAM_END)
+        {
+            members_end = read_offset - inflater.avail_in;
+            output_full = false;
+            inflateReset(&inflater);
+        }
+        else if (rc != Z_OK && rc != Z_BUF_ERROR)
+        {
+            break; // damaged (e.g. zeros left by a crash of the machine)
+        }
+    }
+    inflateEnd(&inflater);
+
+    if (!own_member && members_end == 0 && rc != Z_OK && rc != Z_BUF_ERROR)
+    {
+        throw_spdlog_ex("Failed appending to file " + os::filename_to_str(filename_) + " - not a gzip file");
+    }
+    return members_end;
+}
+
+template<int Level>
+inline size_t gzip_file_helper<Level>::find_last_member_(size_t file_size)
+{
+    // the gzip header written by zlib: 1f 8b, deflate, no flags, no mtime (then any xfl and os bytes)
+    static const unsigned char header[] = {0x1f, 0x8b, 0x08, 0, 0, 0, 0, 0};
+    const size_t header_size = sizeof(header);
+    std::unique_ptr<unsigned char[]> chunk(new unsigned char[out_buffer_size + header_size - 1]);
+    size_t end = file_size; // look for headers starting before end
+    while (end > 0)
+    {
+        size_t begin = end > out_buffer_size ? end - out_buffer_size : 0;
+        // and the bytes of a header starting right before end
+        size_t len = (std::min)(end + header_size - 1, file_size) - begin;
+        if (::pread(fd_, chunk.get(), len, static_cast<off_t>(begin)) != static_cast<ssize_t>(len))
+        {
+            throw_spdlog_ex("Failed reading file " + os::filename_to_str(filename_), errno);
+        }
+        for (size_t i = end - begin; i-- > 0;)
+        {
+            if (i + header_size <= len && std::memcmp(chunk.get() + i, header, header_size) == 0)
+            {
+                return begin + i;
+            }
+        }
+        end = begin;
+    }
+    return file_size;
+}
+
+template<int Level>
+inline void gzip_file_helper<Level>::call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler)
+{
+    if (!handler)
+    {
+        return;
+    }
+    char *data = nullptr;
+    size_t size = 0;
+    std::FILE *stream = ::open_memstream(&data, &size);
+    if (stream == nullptr)
+    {
+        throw_spdlog_ex("Failed opening a stream for the event handler of " + os::filename_to_str(filename_), errno);
+    }
+    try
+    {
+        handler(filename_, stream);
+        std::fclose(stream);
+        stream = nullptr;
+        compress_(data, size, Z_NO_FLUSH);
+    }
+    catch (...)
+    {
+        if (stream != nullptr)
+        {
+            std::fclose(stream);
+        }
+        std::free(data);
+        throw;
+    }
+    std::free(data);
+}
+
+} // namespace details
+} // namespace spdlog
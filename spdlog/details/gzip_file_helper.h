@@ -0,0 +1,92 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <memory>
+
+#include <zlib.h>
+
+#ifndef SPDLOG_GZIP_FILE_LEVEL
+#define SPDLOG_GZIP_FILE_LEVEL 6
+#endif
+
+namespace spdlog {
+namespace details {
+
+// Alternative to file_helper for the file sinks, writing the file gzip compressed, e.g.
+//    sinks::basic_file_sink<std::mutex, details::gzip_file_helper<>>
+//    sinks::rotating_file_sink<std::mutex, details::gzip_file_helper<1>>
+// Needs zlib (link with -lz). Not included by the sinks.
+//
+// The messages are streamed through the compressor into a sequence of gzip members (a valid gzip
+// file, read by zcat/gunzip as a whole). flush() ends the current member and writes it out, so the
+// file is decodable up to the last flush even if the process crashes - e.g. flush when the logger's
+// flush level is reached, or periodically with spdlog::flush_every(..). A member cut short by a crash
+// is removed when the file is opened again (without truncate), so the members added after it are
+// decodable too. Opening a non empty file that isn't gzip throws. Each member costs a few
+// bytes, and the compressor starts over (without the history of the previous member), so flushing
+// very often costs some ratio.
+//
+// size() is the size of the compressed data produced so far - the data still inside the compressor
+// is counted once it comes out (at the latest on flush()). so the max size of the rotating file
+// sink is in compressed bytes.
+//
+// The event handlers get a FILE* over a memory stream, compressed into the file after the handler
+// returns.
+// Level is the zlib compression level: 1 (fastest) to 9 (smallest).
+// When failing to open a file, retry several times(5) with a delay interval(10 ms).
+// Throw spdlog_ex exception on errors.
+template<int Level = SPDLOG_GZIP_FILE_LEVEL>
+class gzip_file_helper
+{
+    static_assert(Level >= 1 && Level <= 9, "Level must be between 1 and 9");
+
+public:
+    gzip_file_helper() = default;
+    explicit gzip_file_helper(const file_event_handlers &event_handlers);
+
+    gzip_file_helper(const gzip_file_helper &) = delete;
+    gzip_file_helper &operator=(const gzip_file_helper &) = delete;
+    ~gzip_file_helper();
+
+    void open(const filename_t &fname, bool truncate = false);
+    void reopen(bool truncate);
+    void flush();
+    void close();
+    void write(const memory_buf_t &buf);
+    // the size of the file in compressed bytes, including what is still buffered
+    size_t size() const;
+    const filename_t &filename() const;
+
+private:
+    static const size_t out_buffer_size = 64 * 1024;
+
+    // compress size bytes of data into the current member (starting one if needed)
+    void compress_(const char *data, size_t size, int flush_mode);
+    // write the compressed bytes out and empty the buffer
+    void write_out_();
+    // the length of the file up to the end of its last complete member
+    size_t recover_size_(size_t file_size);
+    // the offset of the last member header written by this helper, or file_size if none
+    size_t find_last_member_(size_t file_size);
+    void call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler);
+
+    const int open_tries_ = 5;
+    const unsigned int open_interval_ = 10;
+    int fd_ = -1;
+    z_stream stream_{};
+    bool stream_init_ = false;
+    bool in_member_ = false; // data was compressed since the last member ended
+    std::unique_ptr<unsigned char[]> out_buffer_;
+    size_t out_size_ = 0;
+    size_t file_size_ = 0; // written to the file
+    filename_t filename_;
+    file_event_handlers event_handlers_;
+};
+} // namespace details
+} // namespace spdlog
+
+#include "gzip_file_helper-inl.h"
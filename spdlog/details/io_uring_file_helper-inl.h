@@ -0,0 +1,634 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+#include <spdlog/common.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace spdlog {
+namespace details {
+
+inline io_uring_ring::io_uring_ring(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+    {
+        return;
+    }
+    // IORING_OP_WRITE needs linux 5.6, which also brought IORING_FEAT_RW_CUR_POS
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+    {
+        sq_ring_size_ = cq_ring_size_ = (std::max)(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED)
+    {
+        sq_ring_ = nullptr;
+        ::close(fd);
+        return;
+    }
+    if (single_mmap)
+    {
+        cq_ring_ = sq_ring_;
+    }
+    else
+    {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED)
+        {
+            cq_ring_ = nullptr;
+            ::munmap(sq_ring_, sq_ring_size_);
+            sq_ring_ = nullptr;
+            ::close(fd);
+            return;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        if (cq_ring_ != sq_ring_)
+        {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        ::munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = cq_ring_ = nullptr;
+        ::close(fd);
+        return;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    auto *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    auto *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    ring_fd_ = fd;
+}
+
+inline io_uring_ring::~io_uring_ring()
+{
+    if (ring_fd_ == -1)
+    {
+        return;
+    }
+    ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_)
+    {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    ::munmap(sq_ring_, sq_ring_size_);
+    ::close(ring_fd_);
+}
+
+inline bool io_uring_ring::submit_write(int fd, const char *data, size_t size, uint64_t offset, uint64_t user_data)
+{
+    // only this thread produces submissions, so the tail is ours. the kernel reads it.
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    if (enter_(1, 0, 0) != 1)
+    {
+        // not consumed by the kernel (it reads the queue only in io_uring_enter) - take it back
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+template<typename OnComplete>
+inline void io_uring_ring::reap(unsigned min_complete, OnComplete on_complete)
+{
+    unsigned completed = 0;
+    for (;;)
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head, ++completed)
+        {
+            const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+            on_complete(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        if (completed >= min_complete)
+        {
+            return;
+        }
+        if (enter_(0, min_complete - completed, IORING_ENTER_GETEVENTS) < 0)
+        {
+            throw_spdlog_ex("io_uring_enter failed", errno);
+        }
+    }
+}
+
+inline long io_uring_ring::enter_(unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    for (;;)
+    {
+        long rv = ::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+        if (rv >= 0 || errno != EINTR)
+        {
+            return rv;
+        }
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline io_uring_file_helper<BufferSize, MaxInFlight>::io_uring_file_helper(const file_event_handlers &event_handlers)
+    : event_handlers_(event_handlers)
+{}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline io_uring_file_helper<BufferSize, MaxInFlight>::~io_uring_file_helper()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // the pending messages are lost - nothing else to do in a destructor
+    }
+    if (in_flight_ == 0)
+    {
+        give_spare_();
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::open(const filename_t &fname, bool truncate)
+{
+    close();
+    filename_ = fname;
+    error_ = 0;
+
+    if (!ring_)
+    {
+        take_spare_();
+    }
+
+    if (event_handlers_.before_open)
+    {
+        event_handlers_.before_open(filename_);
+    }
+    for (int tries = 0; tries < open_tries_; ++tries)
+    {
+        // create containing folder if not exists already.
+        os::create_dir(os::dir_name(fname));
+        // not O_APPEND - the writes go to explicit offsets
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        fd_ = ::open(fname.c_str(), flags, 0644);
+        if (fd_ != -1)
+        {
+            update_offset_();
+            call_handler_(event_handlers_.after_open);
+            return;
+        }
+
+        details::os::sleep_for_millis(open_interval_);
+    }
+
+    throw_spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", errno);
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::reopen(bool truncate)
+{
+    if (filename_.empty())
+    {
+        throw_spdlog_ex("Failed re opening file - was not opened before");
+    }
+    this->open(filename_, truncate);
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::flush()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+    if (buffers_[current_].size > 0 && !buffers_[current_].failed)
+    {
+        submit_current_();
+    }
+    wait_all_();
+    throw_if_failed_();
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::close()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+
+    // close the file even if the writes failed, and report the error after
+    std::string write_error;
+    try
+    {
+        flush();
+    }
+    catch (const spdlog_ex &ex)
+    {
+        write_error = ex.what();
+        try
+        {
+            wait_all_();
+            retry_failed_();
+        }
+        catch (const spdlog_ex &)
+        {
+            // reaping or writing failed again - still close the file, and report the first error
+        }
+    }
+    if (failed_ > 0)
+    {
+        // cut the file where the first lost write was, rather than leave a hole of zeros in it
+        uint64_t end = offset_;
+        for (auto &b : buffers_)
+        {
+            end = b.failed ? (std::min)(end, b.offset) : end;
+        }
+        (void)::ftruncate(fd_, static_cast<off_t>(end));
+    }
+    for (auto &b : buffers_)
+    {
+        b.size = 0;
+        b.failed = false;
+    }
+    failed_ = 0;
+    error_ = 0;
+
+    call_handler_(event_handlers_.before_close);
+    ::close(fd_);
+    fd_ = -1;
+
+    if (event_handlers_.after_close)
+    {
+        event_handlers_.after_close(filename_);
+    }
+
+    if (!write_error.empty())
+    {
+        throw_spdlog_ex(write_error);
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::write(const memory_buf_t &buf)
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot write to closed file " + os::filename_to_str(filename_));
+    }
+    throw_if_failed_();
+
+    const char *data = buf.data();
+    size_t remaining = buf.size();
+    while (remaining > 0)
+    {
+        auto &b = buffers_[current_];
+        size_t n = (std::min)(remaining, BufferSize - b.size);
+        std::memcpy(b.data.get() + b.size, data, n);
+        b.size += n;
+        data += n;
+        remaining -= n;
+        if (b.size == BufferSize)
+        {
+            submit_current_();
+        }
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline size_t io_uring_file_helper<BufferSize, MaxInFlight>::size() const
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(filename_));
+    }
+    return static_cast<size_t>(offset_) + buffers_[current_].size;
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline const filename_t &io_uring_file_helper<BufferSize, MaxInFlight>::filename() const
+{
+    return filename_;
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline bool io_uring_file_helper<BufferSize, MaxInFlight>::uses_io_uring() const
+{
+    return ring_ && ring_->available();
+}
+
+// never destroyed - helpers may be destroyed by static destructors
+template<size_t BufferSize, size_t MaxInFlight>
+inline typename io_uring_file_helper<BufferSize, MaxInFlight>::spare_list &io_uring_file_helper<BufferSize, MaxInFlight>::spare_list_()
+{
+    static auto *list = new spare_list();
+    return *list;
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::take_spare_()
+{
+    std::unique_ptr<spare> taken;
+    {
+        auto &list = spare_list_();
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (!list.spares.empty())
+        {
+            taken = std::move(list.spares.back());
+            list.spares.pop_back();
+        }
+    }
+    if (!taken)
+    {
+        ring_ = details::make_unique<io_uring_ring>(static_cast<unsigned>(MaxInFlight));
+        for (auto &b : buffers_)
+        {
+            b.data.reset(new char[BufferSize]);
+        }
+        return;
+    }
+    ring_ = std::move(taken->ring);
+    for (size_t i = 0; i < MaxInFlight; i++)
+    {
+        buffers_[i].data = std::move(taken->data[i]);
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::give_spare_()
+{
+    if (!ring_)
+    {
+        return;
+    }
+    auto given = details::make_unique<spare>();
+    given->ring = std::move(ring_);
+    for (size_t i = 0; i < MaxInFlight; i++)
+    {
+        given->data[i] = std::move(buffers_[i].data);
+    }
+    auto &list = spare_list_();
+    std::lock_guard<std::mutex> lock(list.mutex);
+    if (list.spares.size() < SPDLOG_IO_URING_MAX_SPARE_RINGS)
+    {
+        list.spares.push_back(std::move(given));
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::submit_current_()
+{
+    auto &b = buffers_[current_];
+    b.offset = offset_;
+    offset_ += b.size;
+
+    if (uses_io_uring() && ring_->submit_write(fd_, b.data.get(), b.size, b.offset, current_))
+    {
+        b.in_flight = true;
+        in_flight_++;
+        reap_(0);
+    }
+    else
+    {
+        // no io_uring (or the submission failed) - write it right away
+        write_now_(b);
+        if (!b.failed)
+        {
+            return;
+        }
+    }
+
+    // move to a free buffer, waiting for the oldest writes if all are in flight
+    for (;;)
+    {
+        for (size_t i = 1; i <= MaxInFlight; i++)
+        {
+            size_t next = (current_ + i) % MaxInFlight;
+            if (!buffers_[next].in_flight && !buffers_[next].failed)
+            {
+                current_ = next;
+                return;
+            }
+        }
+        if (in_flight_ > 0)
+        {
+            reap_(1);
+        }
+        else
+        {
+            retry_failed_();
+        }
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::write_now_(buffer &b)
+{
+    try
+    {
+        pwrite_all_(b.data.get(), b.size, b.offset);
+        b.size = 0;
+    }
+    catch (const spdlog_ex &)
+    {
+        fail_(b, errno != 0 ? errno : EIO);
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::fail_(buffer &b, int err)
+{
+    error_ = error_ != 0 ? error_ : err;
+    if (!b.failed)
+    {
+        b.failed = true;
+        failed_++;
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::retry_failed_()
+{
+    for (auto &b : buffers_)
+    {
+        if (!b.failed)
+        {
+            continue;
+        }
+        // throws (keeping the buffer) if it fails again. what it wrote before is written again - same bytes, same offsets.
+        pwrite_all_(b.data.get(), b.size, b.offset);
+        b.size = 0;
+        b.failed = false;
+        failed_--;
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::reap_(unsigned min_complete)
+{
+    ring_->reap(min_complete, [this](uint64_t index, int result) { this->on_complete_(index, result); });
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::on_complete_(uint64_t index, int result)
+{
+    auto &b = buffers_[static_cast<size_t>(index)];
+    b.in_flight = false;
+    in_flight_--;
+    if (result < 0)
+    {
+        fail_(b, -result);
+    }
+    else if (static_cast<size_t>(result) < b.size)
+    {
+        // short write - finish it the plain way
+        auto written = static_cast<size_t>(result);
+        std::memmove(b.data.get(), b.data.get() + written, b.size - written);
+        b.size -= written;
+        b.offset += written;
+        write_now_(b);
+    }
+    else
+    {
+        b.size = 0;
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::wait_all_()
+{
+    while (in_flight_ > 0)
+    {
+        reap_(static_cast<unsigned>(in_flight_));
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::throw_if_failed_()
+{
+    if (error_ != 0)
+    {
+        int err = error_;
+        error_ = 0;
+        throw_spdlog_ex("Failed writing to file " + os::filename_to_str(filename_), err);
+    }
+    if (failed_ > 0)
+    {
+        retry_failed_();
+    }
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::pwrite_all_(const char *data, size_t size, uint64_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::pwrite(fd_, data, size, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw_spdlog_ex("Failed writing to file " + os::filename_to_str(filename_), errno);
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+// the event handlers write through a stream at the end of the file, and the next writes go after that
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler)
+{
+    if (!handler)
+    {
+        return;
+    }
+    int dup_fd = ::fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    std::FILE *stream = nullptr;
+    if (dup_fd != -1 && ::lseek(dup_fd, 0, SEEK_END) != -1)
+    {
+        stream = ::fdopen(dup_fd, "wb");
+    }
+    if (stream == nullptr)
+    {
+        if (dup_fd != -1)
+        {
+            ::close(dup_fd);
+        }
+        throw_spdlog_ex("Failed opening a stream for the event handler of " + os::filename_to_str(filename_), errno);
+    }
+    try
+    {
+        handler(filename_, stream);
+    }
+    catch (...)
+    {
+        std::fclose(stream);
+        throw;
+    }
+    std::fclose(stream);
+    update_offset_();
+}
+
+template<size_t BufferSize, size_t MaxInFlight>
+inline void io_uring_file_helper<BufferSize, MaxInFlight>::update_offset_()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        throw_spdlog_ex("Failed getting file size. fd=" + std::to_string(fd_), errno);
+    }
+    offset_ = static_cast<uint64_t>(st.st_size);
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,181 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef SPDLOG_IO_URING_BUFFER_SIZE
+#define SPDLOG_IO_URING_BUFFER_SIZE (64 * 1024)
+#endif
+
+#ifndef SPDLOG_IO_URING_MAX_IN_FLIGHT
+#define SPDLOG_IO_URING_MAX_IN_FLIGHT 8
+#endif
+
+// rings (with their buffers) of destroyed helpers kept for the next ones, per BufferSize/MaxInFlight
+#ifndef SPDLOG_IO_URING_MAX_SPARE_RINGS
+#define SPDLOG_IO_URING_MAX_SPARE_RINGS 4
+#endif
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace spdlog {
+namespace details {
+
+// Minimal io_uring submission/completion ring over the raw syscalls (no liburing), for writes only.
+// available() is false if io_uring cannot be used (old kernel, disabled by seccomp, etc.).
+class io_uring_ring
+{
+public:
+    explicit io_uring_ring(unsigned entries);
+    ~io_uring_ring();
+
+    io_uring_ring(const io_uring_ring &) = delete;
+    io_uring_ring &operator=(const io_uring_ring &) = delete;
+
+    bool available() const
+    {
+        return ring_fd_ != -1;
+    }
+
+    // queue and submit a write of size bytes at the given file offset.
+    // the caller keeps at most "entries" writes in flight.
+    // return false (with errno set) if it couldn't be submitted.
+    bool submit_write(int fd, const char *data, size_t size, uint64_t offset, uint64_t user_data);
+
+    // wait for at least min_complete completions (0 - don't wait), and call
+    // on_complete(user_data, result) for each. result is the bytes written, or -errno.
+    template<typename OnComplete>
+    void reap(unsigned min_complete, OnComplete on_complete);
+
+private:
+    // return the number of submitted entries, -1 on error (errno set)
+    long enter_(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+    int ring_fd_ = -1;
+    void *sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void *cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+// Alternative to file_helper for the file sinks, e.g.
+//    sinks::basic_file_sink<std::mutex, details::io_uring_file_helper<>>
+//
+// Messages are copied into one of MaxInFlight buffers of BufferSize bytes. Full buffers are
+// submitted to io_uring without waiting, and recycled when their write completes, so the
+// (async worker) thread only blocks when all the buffers are in flight.
+// flush() and close() (and so the rotation) submit the current buffer and wait for all the writes.
+// Write errors are reported by the next write()/flush(). The buffer that failed is kept, and written
+// again at its offset by the call after, so the later writes don't leave a hole in the file. If it
+// still fails at close(), the file is cut at its offset.
+//
+// The writes go to explicit offsets tracked here (they may complete out of order), so the file must
+// not be appended to by anyone else while open.
+// Falls back to plain blocking pwrite() calls if io_uring is not available at runtime.
+//
+// The rotating, daily and hourly sinks open each file with a new helper. So a destroyed helper
+// leaves its ring and buffers to the next one to open a file, instead of unmapping them.
+template<size_t BufferSize = SPDLOG_IO_URING_BUFFER_SIZE, size_t MaxInFlight = SPDLOG_IO_URING_MAX_IN_FLIGHT>
+class io_uring_file_helper
+{
+    static_assert(BufferSize > 0, "BufferSize must be greater than zero");
+    static_assert(MaxInFlight > 0, "MaxInFlight must be greater than zero");
+
+public:
+    io_uring_file_helper() = default;
+    explicit io_uring_file_helper(const file_event_handlers &event_handlers);
+
+    io_uring_file_helper(const io_uring_file_helper &) = delete;
+    io_uring_file_helper &operator=(const io_uring_file_helper &) = delete;
+    ~io_uring_file_helper();
+
+    void open(const filename_t &fname, bool truncate = false);
+    void reopen(bool truncate);
+    void flush();
+    void close();
+    void write(const memory_buf_t &buf);
+    // the size of the file, including what is still buffered or in flight
+    size_t size() const;
+    const filename_t &filename() const;
+
+    // false if io_uring is not available and the writes are done with pwrite()
+    bool uses_io_uring() const;
+
+private:
+    struct buffer
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        uint64_t offset = 0;
+        bool in_flight = false;
+        bool failed = false; // its write failed - kept, to be written again at offset
+    };
+
+    // a ring and its buffers, between helpers
+    struct spare
+    {
+        std::unique_ptr<io_uring_ring> ring;
+        std::unique_ptr<char[]> data[MaxInFlight];
+    };
+    struct spare_list
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<spare>> spares;
+    };
+    static spare_list &spare_list_();
+    // take the ring and the buffers of a destroyed helper, or create them
+    void take_spare_();
+    // leave the ring and the buffers to the next helper
+    void give_spare_();
+
+    // submit the current buffer, and move to a free one (waiting for one if needed)
+    void submit_current_();
+    // write the buffer with pwrite(). on failure keep it (failed) and record the error
+    void write_now_(buffer &b);
+    void fail_(buffer &b, int err);
+    // write the failed buffers again. throw spdlog_ex if one still fails
+    void retry_failed_();
+    // wait for at least min_complete writes, and recycle their buffers
+    void reap_(unsigned min_complete);
+    void on_complete_(uint64_t index, int result);
+    void wait_all_();
+    void throw_if_failed_();
+    void pwrite_all_(const char *data, size_t size, uint64_t offset);
+    void call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler);
+    void update_offset_();
+
+    const int open_tries_ = 5;
+    const unsigned int open_interval_ = 10;
+    int fd_ = -1;
+    std::unique_ptr<io_uring_ring> ring_;
+    buffer buffers_[MaxInFlight];
+    size_t current_ = 0;
+    size_t in_flight_ = 0;
+    size_t failed_ = 0;   // buffers whose write failed
+    uint64_t offset_ = 0; // where the current buffer goes
+    int error_ = 0;       // errno of a failed write, reported by the next call
+    filename_t filename_;
+    file_event_handlers event_handlers_;
+};
+} // namespace details
+} // namespace spdlog
+
+#include "io_uring_file_helper-inl.h"
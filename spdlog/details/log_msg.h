@@ -28,6 +28,10 @@ struct log_msg
 
     source_loc source;
     string_view_t payload;
+
+    // the format string and arguments the payload is formatted from, when captured
+    // by the logger (see details::encode_deferred(..)). empty otherwise.
+    string_view_t captured_args;
 };
 } // namespace details
 } // namespace spdlog
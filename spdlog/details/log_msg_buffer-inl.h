@@ -10,6 +10,7 @@ inline log_msg_buffer::log_msg_buffer(const log_msg &orig_msg)
     : log_msg{orig_msg}
 {
     buffer.append(logger_name.begin(), logger_name.end());
+    buffer.append(captured_args.begin(), captured_args.end());
     buffer.append(payload.begin(), payload.end());
     update_string_views();
 }
@@ -18,6 +19,7 @@ inline log_msg_buffer::log_msg_buffer(const log_msg_buffer &other)
     : log_msg{other}
 {
     buffer.append(logger_name.begin(), logger_name.end());
+    buffer.append(captured_args.begin(), captured_args.end());
     buffer.append(payload.begin(), payload.end());
     update_string_views();
 }
@@ -47,7 +49,8 @@ inline log_msg_buffer &log_msg_buffer::operator=(log_msg_buffer &&other) noexcep
 inline void log_msg_buffer::update_string_views()
 {
     logger_name = string_view_t{buffer.data(), logger_name.size()};
-    payload = string_view_t{buffer.data() + logger_name.size(), payload.size()};
+    captured_args = string_view_t{buffer.data() + logger_name.size(), captured_args.size()};
+    payload = string_view_t{buffer.data() + logger_name.size() + captured_args.size(), payload.size()};
 }
 
 } // namespace details
@@ -0,0 +1,290 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+#include <spdlog/common.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace spdlog {
+namespace details {
+
+namespace mmap_trailer {
+// not found in text (nor likely at the end of binary content)
+static const char magic[8] = {'\0', '\xff', 's', 'p', 'd', 'l', 'o', 'g'};
+} // namespace mmap_trailer
+
+template<size_t WindowSize>
+inline mmap_file_helper<WindowSize>::mmap_file_helper(const file_event_handlers &event_handlers)
+    : event_handlers_(event_handlers)
+{}
+
+template<size_t WindowSize>
+inline mmap_file_helper<WindowSize>::~mmap_file_helper()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // the file keeps its zero tail - cut on the next open
+    }
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::open(const filename_t &fname, bool truncate)
+{
+    close();
+    filename_ = fname;
+
+    // the window is mapped at page boundaries, and must hold a page worth of content besides the trailer
+    auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    if (WindowSize % page_size != 0 || WindowSize < 2 * page_size)
+    {
+        throw_spdlog_ex("mmap_file_helper: the window size (" + std::to_string(WindowSize) + ") must be a multiple of the page size (" +
+                        std::to_string(page_size) + "), of at least two pages");
+    }
+
+    if (event_handlers_.before_open)
+    {
+        event_handlers_.before_open(filename_);
+    }
+    for (int tries = 0; tries < open_tries_; ++tries)
+    {
+        // create containing folder if not exists already.
+        os::create_dir(os::dir_name(fname));
+        int flags = O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        fd_ = ::open(fname.c_str(), flags, 0644);
+        if (fd_ != -1)
+        {
+            size_ = recover_size_();
+            call_handler_(event_handlers_.after_open);
+            return;
+        }
+
+        details::os::sleep_for_millis(open_interval_);
+    }
+
+    throw_spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", errno);
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::reopen(bool truncate)
+{
+    if (filename_.empty())
+    {
+        throw_spdlog_ex("Failed re opening file - was not opened before");
+    }
+    this->open(filename_, truncate);
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::flush()
+{}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::close()
+{
+    if (fd_ == -1)
+    {
+        return;
+    }
+
+    unmap_window_();
+    int truncate_errno = ::ftruncate(fd_, static_cast<off_t>(size_)) == 0 ? 0 : errno;
+
+    call_handler_(event_handlers_.before_close);
+    ::close(fd_);
+    fd_ = -1;
+
+    if (event_handlers_.after_close)
+    {
+        event_handlers_.after_close(filename_);
+    }
+
+    if (truncate_errno != 0)
+    {
+        throw_spdlog_ex("Failed truncating file " + os::filename_to_str(filename_), truncate_errno);
+    }
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::write(const memory_buf_t &buf)
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot write to closed file " + os::filename_to_str(filename_));
+    }
+
+    const char *data = buf.data();
+    size_t remaining = buf.size();
+    while (remaining > 0)
+    {
+        if (window_ == nullptr || size_ == window_offset_ + window_capacity)
+        {
+            map_window_();
+        }
+        size_t pos = size_ - window_offset_;
+        size_t n = (std::min)(remaining, window_capacity - pos);
+        std::memcpy(window_ + pos, data, n);
+        size_ += n;
+        data += n;
+        remaining -= n;
+    }
+    if (window_ != nullptr)
+    {
+        auto real_size = static_cast<std::uint64_t>(size_);
+        std::memcpy(window_ + WindowSize - sizeof(real_size), &real_size, sizeof(real_size));
+    }
+}
+
+template<size_t WindowSize>
+inline size_t mmap_file_helper<WindowSize>::size() const
+{
+    if (fd_ == -1)
+    {
+        throw_spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(filename_));
+    }
+    return size_;
+}
+
+template<size_t WindowSize>
+inline const filename_t &mmap_file_helper<WindowSize>::filename() const
+{
+    return filename_;
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::map_window_()
+{
+    unmap_window_();
+
+    auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t offset = size_ - size_ % page_size;
+
+    // the trailer is written first, extending the file - so the file never ends without it
+    char trailer[trailer_size];
+    auto real_size = static_cast<std::uint64_t>(size_);
+    std::memcpy(trailer, mmap_trailer::magic, sizeof(mmap_trailer::magic));
+    std::memcpy(trailer + sizeof(mmap_trailer::magic), &real_size, sizeof(real_size));
+    if (::pwrite(fd_, trailer, trailer_size, static_cast<off_t>(offset + window_capacity)) != static_cast<ssize_t>(trailer_size))
+    {
+        throw_spdlog_ex("Failed extending file " + os::filename_to_str(filename_), errno);
+    }
+
+    // allocate the blocks up front - writing to a mapped hole on a full disk would be a SIGBUS
+    int rv = ::posix_fallocate(fd_, static_cast<off_t>(offset), static_cast<off_t>(WindowSize));
+    if (rv != 0)
+    {
+        throw_spdlog_ex("Failed extending file " + os::filename_to_str(filename_), rv);
+    }
+    void *window = ::mmap(nullptr, WindowSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+    if (window == MAP_FAILED)
+    {
+        throw_spdlog_ex("Failed mapping file " + os::filename_to_str(filename_), errno);
+    }
+    window_ = static_cast<char *>(window);
+    window_offset_ = offset;
+}
+
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::unmap_window_()
+{
+    if (window_ != nullptr)
+    {
+        ::munmap(window_, WindowSize);
+        window_ = nullptr;
+    }
+}
+
+template<size_t WindowSize>
+inline size_t mmap_file_helper<WindowSize>::recover_size_()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        throw_spdlog_ex("Failed getting file size. fd=" + std::to_string(fd_), errno);
+    }
+    auto file_size = static_cast<size_t>(st.st_size);
+
+    // a window left mapped by a crash - its trailer tells the real length
+    size_t end = file_size;
+    char trailer[trailer_size];
+    if (file_size >= trailer_size)
+    {
+        ssize_t n = ::pread(fd_, trailer, trailer_size, static_cast<off_t>(file_size - trailer_size));
+        if (n != static_cast<ssize_t>(trailer_size))
+        {
+            throw_spdlog_ex("Failed reading file " + os::filename_to_str(filename_), errno);
+        }
+        std::uint64_t real_size;
+        std::memcpy(&real_size, trailer + sizeof(mmap_trailer::magic), sizeof(real_size));
+        if (std::memcmp(trailer, mmap_trailer::magic, sizeof(mmap_trailer::magic)) == 0 && real_size <= file_size - trailer_size)
+        {
+            end = static_cast<size_t>(real_size);
+        }
+    }
+
+    if (end != file_size && ::ftruncate(fd_, static_cast<off_t>(end)) != 0)
+    {
+        throw_spdlog_ex("Failed truncating file " + os::filename_to_str(filename_), errno);
+    }
+    return end;
+}
+
+// the event handlers write through a stream at the end of the file, and the next writes go after that
+template<size_t WindowSize>
+inline void mmap_file_helper<WindowSize>::call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler)
+{
+    if (!handler)
+    {
+        return;
+    }
+    int dup_fd = ::fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    std::FILE *stream = nullptr;
+    if (dup_fd != -1 && ::lseek(dup_fd, static_cast<off_t>(size_), SEEK_SET) != -1)
+    {
+        stream = ::fdopen(dup_fd, "wb");
+    }
+    if (stream == nullptr)
+    {
+        if (dup_fd != -1)
+        {
+            ::close(dup_fd);
+        }
+        throw_spdlog_ex("Failed opening a stream for the event handler of " + os::filename_to_str(filename_), errno);
+    }
+    try
+    {
+        handler(filename_, stream);
+    }
+    catch (...)
+    {
+        std::fclose(stream);
+        throw;
+    }
+    std::fclose(stream);
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        throw_spdlog_ex("Failed getting file size. fd=" + std::to_string(fd_), errno);
+    }
+    size_ = (std::max)(size_, static_cast<size_t>(st.st_size));
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,77 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#ifndef SPDLOG_MMAP_WINDOW_SIZE
+#define SPDLOG_MMAP_WINDOW_SIZE (4 * 1024 * 1024)
+#endif
+
+namespace spdlog {
+namespace details {
+
+// Alternative to file_helper for the file sinks, e.g.
+//    sinks::rotating_file_sink<std::mutex, details::mmap_file_helper<>>
+//
+// The file is extended with fallocate() a window (WindowSize bytes, a multiple of the page size,
+// of at least two pages) at a time, and the window is mapped shared, so writes are plain memory
+// copies. What was written is owned by the kernel right away and survives a crash of the process
+// (even SIGKILL), without any flush. It doesn't survive a crash of the machine unless flushed
+// (msync) - flush() doesn't.
+//
+// The last bytes of the window hold a trailer with the real length of the file, updated on each
+// write. The file is truncated to its real length on close. After a crash it ends with the unused
+// part of the window and the trailer, which are cut on the next open (so any content, including
+// binary records, is kept as is).
+// The event handlers get a FILE* over a duplicate of the descriptor, positioned at the end.
+// When failing to open a file, retry several times(5) with a delay interval(10 ms).
+// Throw spdlog_ex exception on errors.
+template<size_t WindowSize = SPDLOG_MMAP_WINDOW_SIZE>
+class mmap_file_helper
+{
+    static_assert(WindowSize > 4096 && WindowSize % 4096 == 0, "WindowSize must be a multiple of 4096, of at least two pages");
+
+public:
+    mmap_file_helper() = default;
+    explicit mmap_file_helper(const file_event_handlers &event_handlers);
+
+    mmap_file_helper(const mmap_file_helper &) = delete;
+    mmap_file_helper &operator=(const mmap_file_helper &) = delete;
+    ~mmap_file_helper();
+
+    void open(const filename_t &fname, bool truncate = false);
+    void reopen(bool truncate);
+    // nothing to do - the data is already in the kernel's hands
+    void flush();
+    void close();
+    void write(const memory_buf_t &buf);
+    size_t size() const;
+    const filename_t &filename() const;
+
+private:
+    // at the end of the window: magic, then the real length of the file
+    static constexpr size_t trailer_size = 16;
+    static constexpr size_t window_capacity = WindowSize - trailer_size;
+
+    // map the window the current size falls in, extending the file if needed
+    void map_window_();
+    void unmap_window_();
+    // the real length of the file - without the end of the window a crash may have left
+    size_t recover_size_();
+    void call_handler_(const std::function<void(const filename_t &, std::FILE *)> &handler);
+
+    const int open_tries_ = 5;
+    const unsigned int open_interval_ = 10;
+    int fd_ = -1;
+    char *window_ = nullptr;
+    size_t window_offset_ = 0; // file offset of window_
+    size_t size_ = 0;          // the real length of the file
+    filename_t filename_;
+    file_event_handlers event_handlers_;
+};
+} // namespace details
+} // namespace spdlog
+
+#include "mmap_file_helper-inl.h"
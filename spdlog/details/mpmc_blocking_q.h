@@ -7,12 +7,25 @@
 // enqueue(..) - will block until room found to put the new message.
 // enqueue_nowait(..) - will return immediately with false if no room left in
 // the queue.
+// try_enqueue(..) - will return false if no room left.
 // dequeue_for(..) - will block until the queue is not empty or timeout have
 // passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but pops up to max_items
+// messages under a single lock.
+// try_dequeue_bulk(..) - pops up to max_items messages without waiting.
+//
+// blocked threads may first busy wait (see spin_wait) before parking on the
+// condition variables. the condition variables are notified only if some
+// thread is actually parked on them.
+//
+// on_overrun (optional) is called with each item overrun by enqueue_nowait(..),
+// under the queue lock, before the item is discarded.
 
 #include <spdlog/details/circular_q.h>
+#include <spdlog/details/spin_wait.h>
 
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 
 namespace spdlog {
@@ -23,47 +36,102 @@ class mpmc_blocking_queue
 {
 public:
     using item_type = T;
-    explicit mpmc_blocking_queue(size_t max_items)
-        : q_(max_items)
+    explicit mpmc_blocking_queue(size_t max_items, spin_wait spin = spin_wait{}, std::function<void(T &)> on_overrun = nullptr)
+        : spin_(spin)
+        , on_overrun_(std::move(on_overrun))
+        , q_(max_items)
     {}
 
 #ifndef __MINGW32__
     // try to enqueue and block if no room left
     void enqueue(T &&item)
     {
+        if (spin_.until([this, &item] { return this->try_enqueue_(item); }))
+        {
+            return;
+        }
+        bool wake;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
+            waiting_producers_++;
             pop_cv_.wait(lock, [this] { return !this->q_.full(); });
+            waiting_producers_--;
             q_.push_back(std::move(item));
+            wake = waiting_consumers_ > 0;
+        }
+        if (wake)
+        {
+            push_cv_.notify_one();
         }
-        push_cv_.notify_one();
     }
 
     // enqueue immediately. overrun oldest message in the queue if no room left.
     void enqueue_nowait(T &&item)
     {
+        bool wake;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
+            overrun_front_if_full_();
             q_.push_back(std::move(item));
+            wake = waiting_consumers_ > 0;
+        }
+        if (wake)
+        {
+            push_cv_.notify_one();
         }
-        push_cv_.notify_one();
+    }
+
+    // enqueue if there is room. Return true, if succeeded
+    bool try_enqueue(T &&item)
+    {
+        bool wake;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (q_.full())
+            {
+                return false;
+            }
+            q_.push_back(std::move(item));
+            wake = waiting_consumers_ > 0;
+        }
+        if (wake)
+        {
+            push_cv_.notify_one();
+        }
+        return true;
     }
 
     // try to dequeue item. if no item found. wait up to timeout and try again
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
     {
+        return dequeue_bulk_for(&popped_item, 1, wait_duration) == 1;
+    }
+
+    // try to dequeue up to max_items items. if no item found. wait up to timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        size_t n = 0;
+        if (spin_.until([this, popped_items, max_items, &n] { return (n = this->try_dequeue_bulk_(popped_items, max_items)) > 0; }))
+        {
+            return n;
+        }
+        size_t wake;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
+            waiting_consumers_++;
+            bool not_empty = push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); });
+            waiting_consumers_--;
+            if (!not_empty)
             {
-                return false;
+                return 0;
             }
-            popped_item = std::move(q_.front());
-            q_.pop_front();
+            n = pop_bulk_(popped_items, max_items);
+            wake = waiting_producers_;
         }
-        pop_cv_.notify_one();
-        return true;
+        notify_producers_(wake, n);
+        return n;
     }
 
 #else
@@ -73,37 +141,90 @@ public:
     // try to enqueue and block if no room left
     void enqueue(T &&item)
     {
+        if (spin_.until([this, &item] { return this->try_enqueue_(item); }))
+        {
+            return;
+        }
         std::unique_lock<std::mutex> lock(queue_mutex_);
+        waiting_producers_++;
         pop_cv_.wait(lock, [this] { return !this->q_.full(); });
+        waiting_producers_--;
         q_.push_back(std::move(item));
-        push_cv_.notify_one();
+        if (waiting_consumers_ > 0)
+        {
+            push_cv_.notify_one();
+        }
     }
 
     // enqueue immediately. overrun oldest message in the queue if no room left.
     void enqueue_nowait(T &&item)
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
+        overrun_front_if_full_();
+        q_.push_back(std::move(item));
+        if (waiting_consumers_ > 0)
+        {
+            push_cv_.notify_one();
+        }
+    }
+
+    // enqueue if there is room. Return true, if succeeded
+    bool try_enqueue(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (q_.full())
+        {
+            return false;
+        }
         q_.push_back(std::move(item));
-        push_cv_.notify_one();
+        if (waiting_consumers_ > 0)
+        {
+            push_cv_.notify_one();
+        }
+        return true;
     }
 
     // try to dequeue item. if no item found. wait up to timeout and try again
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
     {
+        return dequeue_bulk_for(&popped_item, 1, wait_duration) == 1;
+    }
+
+    // try to dequeue up to max_items items. if no item found. wait up to timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        size_t n = 0;
+        if (spin_.until([this, popped_items, max_items, &n] { return (n = this->try_dequeue_bulk_(popped_items, max_items)) > 0; }))
+        {
+            return n;
+        }
         std::unique_lock<std::mutex> lock(queue_mutex_);
-        if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
+        waiting_consumers_++;
+        bool not_empty = push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); });
+        waiting_consumers_--;
+        if (!not_empty)
         {
-            return false;
+            return 0;
         }
-        popped_item = std::move(q_.front());
-        q_.pop_front();
-        pop_cv_.notify_one();
-        return true;
+        n = pop_bulk_(popped_items, max_items);
+        notify_producers_(waiting_producers_, n);
+        return n;
     }
 
 #endif
 
+    // dequeue up to max_items items without waiting
+    // Return the number of dequeued items
+    size_t try_dequeue_bulk(T *popped_items, size_t max_items)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        size_t n = pop_bulk_(popped_items, max_items);
+        notify_producers_(waiting_producers_, n);
+        return n;
+    }
+
     size_t overrun_counter()
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
@@ -123,9 +244,80 @@ public:
     }
 
 private:
+    // non blocking attempts used while spinning - give up if the lock is busy.
+    // they notify under the lock, which is fine since it happens only if some thread is parked.
+    bool try_enqueue_(T &item)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || q_.full())
+        {
+            return false;
+        }
+        q_.push_back(std::move(item));
+        if (waiting_consumers_ > 0)
+        {
+            push_cv_.notify_one();
+        }
+        return true;
+    }
+
+    size_t try_dequeue_bulk_(T *popped_items, size_t max_items)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            return 0;
+        }
+        size_t n = pop_bulk_(popped_items, max_items);
+        notify_producers_(waiting_producers_, n);
+        return n;
+    }
+
+    // must be called under the lock. the item is then overrun by push_back(..)
+    void overrun_front_if_full_()
+    {
+        if (on_overrun_ && q_.full())
+        {
+            on_overrun_(q_.front());
+        }
+    }
+
+    // must be called under the lock
+    size_t pop_bulk_(T *popped_items, size_t max_items)
+    {
+        size_t n = 0;
+        while (n < max_items && !q_.empty())
+        {
+            popped_items[n++] = std::move(q_.front());
+            q_.pop_front();
+        }
+        return n;
+    }
+
+    // n slots were freed - wake all the parked producers if more than one
+    void notify_producers_(size_t waiting, size_t n)
+    {
+        if (waiting == 0 || n == 0)
+        {
+            return;
+        }
+        if (n > 1)
+        {
+            pop_cv_.notify_all();
+        }
+        else
+        {
+            pop_cv_.notify_one();
+        }
+    }
+
+    const spin_wait spin_;
+    const std::function<void(T &)> on_overrun_;
     std::mutex queue_mutex_;
     std::condition_variable push_cv_;
     std::condition_variable pop_cv_;
+    size_t waiting_consumers_ = 0; // protected by queue_mutex_
+    size_t waiting_producers_ = 0; // protected by queue_mutex_
     spdlog::details::circular_q<T> q_;
 };
 } // namespace details
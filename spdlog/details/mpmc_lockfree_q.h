@@ -0,0 +1,309 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// bounded multi producer-multi consumer lock-free queue.
+// based on Dmitry Vyukov's bounded mpmc queue: each slot carries a sequence
+// number telling producers and consumers whether it is ready for them, so the
+// fast path is a single CAS on the enqueue (or dequeue) position.
+//
+// enqueue(..) - will block until room found to put the new message.
+// enqueue_nowait(..) - will overrun the oldest message in the queue if no room left.
+// try_enqueue(..) - will return false if no room left.
+// dequeue_for(..) - will block until the queue is not empty or timeout have
+// passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but pops up to max_items
+// messages.
+// try_dequeue_bulk(..) - pops up to max_items messages without waiting.
+//
+// the mutex and condition variables are only used to park threads (after
+// busy waiting, see spin_wait): producers wake the consumers only if some
+// consumer is actually parked (and vice versa).
+//
+// on_overrun (optional) is called with each item overrun by enqueue_nowait(..),
+// once the item is out of the queue.
+
+#include <spdlog/details/spin_wait.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace spdlog {
+namespace details {
+
+static constexpr size_t cache_line_size = 64;
+
+template<typename T>
+class mpmc_lockfree_queue
+{
+public:
+    using item_type = T;
+    explicit mpmc_lockfree_queue(size_t max_items, spin_wait spin = spin_wait{}, std::function<void(T &)> on_overrun = nullptr)
+        : spin_(spin)
+        , on_overrun_(std::move(on_overrun))
+        , max_items_(max_items)
+        , slots_(new slot[max_items])
+    {
+        for (size_t i = 0; i < max_items_; i++)
+        {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpmc_lockfree_queue(const mpmc_lockfree_queue &) = delete;
+    mpmc_lockfree_queue &operator=(const mpmc_lockfree_queue &) = delete;
+
+    // try to enqueue and block if no room left
+    void enqueue(T &&item)
+    {
+        if (!spin_.until([this, &item] { return this->try_enqueue_(item); }))
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            waiting_producers_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            pop_cv_.wait(lock, [this, &item] { return this->try_enqueue_(item); });
+            waiting_producers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        notify_consumers_();
+    }
+
+    // enqueue immediately. overrun oldest message in the queue if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        while (!try_enqueue_(item))
+        {
+            if (!on_overrun_)
+            {
+                if (try_dequeue_(nullptr))
+                {
+                    overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+            T overrun_item;
+            if (try_dequeue_(&overrun_item))
+            {
+                overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+                on_overrun_(overrun_item);
+            }
+        }
+        notify_consumers_();
+    }
+
+    // enqueue if there is room. Return true, if succeeded
+    bool try_enqueue(T &&item)
+    {
+        if (!try_enqueue_(item))
+        {
+            return false;
+        }
+        notify_consumers_();
+        return true;
+    }
+
+    // try to dequeue item. if no item found. wait up to timeout and try again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        if (!spin_.until([this, &popped_item] { return this->try_dequeue_(&popped_item); }))
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            waiting_consumers_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool dequeued = push_cv_.wait_for(lock, wait_duration, [this, &popped_item] { return this->try_dequeue_(&popped_item); });
+            waiting_consumers_.fetch_sub(1, std::memory_order_relaxed);
+            if (!dequeued)
+            {
+                return false;
+            }
+        }
+        notify_producers_(1);
+        return true;
+    }
+
+    // try to dequeue up to max_items items. if no item found. wait up to timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        if (max_items == 0 || !dequeue_for(popped_items[0], wait_duration))
+        {
+            return 0;
+        }
+        size_t n = 1;
+        while (n < max_items && try_dequeue_(&popped_items[n]))
+        {
+            n++;
+        }
+        if (n > 1)
+        {
+            notify_producers_(n - 1);
+        }
+        return n;
+    }
+
+    // dequeue up to max_items items without waiting
+    // Return the number of dequeued items
+    size_t try_dequeue_bulk(T *popped_items, size_t max_items)
+    {
+        size_t n = 0;
+        while (n < max_items && try_dequeue_(&popped_items[n]))
+        {
+            n++;
+        }
+        if (n > 0)
+        {
+            notify_producers_(n);
+        }
+        return n;
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+    // approximate number of messages in the queue (exact when no other thread
+    // is pushing or popping concurrently)
+    size_t size()
+    {
+        size_t head = dequeue_pos_.load(std::memory_order_acquire);
+        size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+        return tail > head ? (std::min)(tail - head, max_items_) : 0;
+    }
+
+    void reset_overrun_counter()
+    {
+        overrun_counter_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct slot
+    {
+        std::atomic<size_t> seq{0};
+        T item;
+    };
+
+    // the slot at position pos is free for a producer when its seq == pos,
+    // and holds an item for a consumer when its seq == pos + 1.
+    bool try_enqueue_(T &item)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot &s = slots_[pos % max_items_];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    s.item = std::move(item);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // pass nullptr to drop the item
+    bool try_dequeue_(T *popped_item)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot &s = slots_[pos % max_items_];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    if (popped_item != nullptr)
+                    {
+                        *popped_item = std::move(s.item);
+                    }
+                    s.seq.store(pos + max_items_, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // the fence pairs with the one taken by a parking thread after it registered
+    // itself as waiting: either we see the waiter, or the waiter sees our item.
+    void notify_consumers_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_consumers_.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+            }
+            push_cv_.notify_one();
+        }
+    }
+
+    // n is the number of slots freed
+    void notify_producers_(size_t n)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_producers_.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+            }
+            if (n > 1)
+            {
+                pop_cv_.notify_all();
+            }
+            else
+            {
+                pop_cv_.notify_one();
+            }
+        }
+    }
+
+    const spin_wait spin_;
+    const std::function<void(T &)> on_overrun_;
+    const size_t max_items_;
+    std::unique_ptr<slot[]> slots_;
+
+    // keep the producers' and consumers' positions on separate cache lines
+    char pad0_[cache_line_size];
+    std::atomic<size_t> enqueue_pos_{0};
+    char pad1_[cache_line_size - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_{0};
+    char pad2_[cache_line_size - sizeof(std::atomic<size_t>)];
+
+    std::atomic<size_t> overrun_counter_{0};
+    std::atomic<size_t> waiting_consumers_{0};
+    std::atomic<size_t> waiting_producers_{0};
+    std::mutex queue_mutex_;
+    std::condition_variable push_cv_;
+    std::condition_variable pop_cv_;
+};
+} // namespace details
+} // namespace spdlog
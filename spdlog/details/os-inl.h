@@ -6,6 +6,7 @@
 #include <spdlog/common.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
@@ -19,6 +20,9 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
 #include <sys/syscall.h> //Use gettid() syscall under linux to get thread id
 
 #ifndef __has_feature          // Clang - feature checking macros.
@@ -163,6 +167,59 @@ inline void sleep_for_millis(unsigned int milliseconds) noexcept
     std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
 }
 
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+inline bool set_thread_affinity(const std::vector<size_t> &cpus) noexcept
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus)
+    {
+        if (cpu >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        CPU_SET(cpu, &cpu_set);
+    }
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+inline bool set_thread_name(const std::string &name) noexcept
+{
+    // the kernel limit is 16 bytes, including the terminating null
+    char buf[16];
+    auto len = (std::min)(name.size(), sizeof(buf) - 1);
+    std::memcpy(buf, name.data(), len);
+    buf[len] = '\0';
+    return ::pthread_setname_np(::pthread_self(), buf) == 0;
+}
+
+inline bool set_thread_nice(int increment) noexcept
+{
+    // on linux the nice value is per thread
+    auto tid = static_cast<id_t>(_thread_id());
+    errno = 0;
+    int current = ::getpriority(PRIO_PROCESS, tid);
+    if (current == -1 && errno != 0)
+    {
+        return false;
+    }
+    return ::setpriority(PRIO_PROCESS, tid, current + increment) == 0;
+}
+
+inline bool set_thread_sched_idle() noexcept
+{
+    sched_param param{};
+    return ::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &param) == 0;
+}
+
 inline std::string filename_to_str(const filename_t &filename)
 {
     return filename;
@@ -5,6 +5,8 @@
 
 #include <spdlog/common.h>
 #include <ctime> // std::time_t
+#include <string>
+#include <vector>
 
 namespace spdlog {
 namespace details {
@@ -64,6 +66,22 @@ size_t thread_id() noexcept;
 // See https://github.com/gabime/spdlog/issues/609
 void sleep_for_millis(unsigned int milliseconds) noexcept;
 
+// Hint the cpu that the calling thread is busy waiting (pause instruction on x86).
+void cpu_relax() noexcept;
+
+// Calling thread setup. Return false on failure.
+// Restrict the calling thread to the given cpus.
+bool set_thread_affinity(const std::vector<size_t> &cpus) noexcept;
+
+// Set the calling thread name (truncated to 15 chars, as shown by top/perf).
+bool set_thread_name(const std::string &name) noexcept;
+
+// Add the given increment to the calling thread nice value.
+bool set_thread_nice(int increment) noexcept;
+
+// Run the calling thread with the SCHED_IDLE scheduling policy.
+bool set_thread_sched_idle() noexcept;
+
 std::string filename_to_str(const filename_t &filename);
 
 int pid() noexcept;
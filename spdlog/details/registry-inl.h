@@ -190,9 +190,16 @@ inline void registry::set_error_handler(err_handler handler)
     {
         l.second->set_error_handler(handler);
     }
+    std::lock_guard<std::mutex> handler_lock(err_handler_mutex_);
     err_handler_ = std::move(handler);
 }
 
+inline err_handler registry::get_error_handler()
+{
+    std::lock_guard<std::mutex> lock(err_handler_mutex_);
+    return err_handler_;
+}
+
 inline void registry::apply_all(const std::function<void(const std::shared_ptr<logger>)> &fun)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
@@ -65,6 +65,9 @@ public:
 
     void set_error_handler(err_handler handler);
 
+    // the handler set by set_error_handler(..), for errors outside the loggers (e.g. of the file housekeeper)
+    err_handler get_error_handler();
+
     void apply_all(const std::function<void(const std::shared_ptr<logger>)> &fun);
 
     void flush_all();
@@ -93,6 +96,7 @@ private:
     void register_logger_(std::shared_ptr<logger> new_logger);
     bool set_level_from_cfg_(logger *logger);
     std::mutex logger_map_mutex_, flusher_mutex_;
+    std::mutex err_handler_mutex_; // get_error_handler() may be called while logger_map_mutex_ is held (e.g. in apply_all)
     std::recursive_mutex tp_mutex_;
     std::unordered_map<std::string, std::shared_ptr<logger>> loggers_;
     log_levels log_levels_;
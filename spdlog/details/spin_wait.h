@@ -0,0 +1,60 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// bounded busy wait, tried by the queues before parking a thread.
+// tries once, then spins with cpu pause hints, then yields the cpu, then gives up.
+// a default constructed spin_wait gives up after the first try.
+
+#include <spdlog/details/os.h>
+
+#include <cstddef>
+#include <thread>
+
+namespace spdlog {
+namespace details {
+
+class spin_wait
+{
+public:
+    spin_wait() = default;
+
+    spin_wait(size_t spin_count, size_t yield_count)
+        : spin_count_(spin_count)
+        , yield_count_(yield_count)
+    {}
+
+    // return true as soon as pred() returns true, false if gave up waiting
+    template<typename Pred>
+    bool until(Pred pred) const
+    {
+        if (pred())
+        {
+            return true;
+        }
+        for (size_t i = 0; i < spin_count_; i++)
+        {
+            os::cpu_relax();
+            if (pred())
+            {
+                return true;
+            }
+        }
+        for (size_t i = 0; i < yield_count_; i++)
+        {
+            std::this_thread::yield();
+            if (pred())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    size_t spin_count_ = 0;
+    size_t yield_count_ = 0;
+};
+} // namespace details
+} // namespace spdlog
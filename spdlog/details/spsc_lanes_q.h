@@ -0,0 +1,471 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// multi producer-multi consumer queue made of single producer lanes.
+// each producer thread lazily gets its own bounded spsc ring (lane) the first
+// time it enqueues, so producers never write to a cache line shared with other
+// producers. each item is stamped with the (steady clock) time it was enqueued,
+// and consumers drain all the lanes, each time popping the lane head with the
+// smallest stamp. so items are popped in the order they were enqueued (items
+// enqueued by different threads within the clock resolution may be swapped),
+// whatever the items themselves contain.
+//
+// enqueue(..) - will block until room found in the caller's lane.
+// enqueue_nowait(..) - will overrun the oldest message of the caller's lane if no room left.
+// try_enqueue(..) - will return false if no room left in the caller's lane.
+// dequeue_for(..) - will block until some lane is not empty or timeout have
+// passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but pops up to max_items
+// messages.
+// try_dequeue_bulk(..) - pops up to max_items messages without waiting.
+//
+// the lane of an exited thread is reclaimed once it has been drained.
+// consumers are serialized with a mutex that producers take only when
+// registering their lane or overrunning an item. blocked threads busy wait
+// (see spin_wait) before parking, and are woken only if actually parked.
+//
+// on_overrun (optional) is called with each item overrun by enqueue_nowait(..),
+// under the consumer mutex, before the item is discarded.
+
+#include <spdlog/details/mpmc_lockfree_q.h> // cache_line_size
+#include <spdlog/details/spin_wait.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+
+template<typename T>
+class spsc_lanes_queue
+{
+public:
+    using item_type = T;
+
+    // max_items is the capacity of each lane.
+    explicit spsc_lanes_queue(size_t max_items, spin_wait spin = spin_wait{}, std::function<void(T &)> on_overrun = nullptr)
+        : spin_(spin)
+        , on_overrun_(std::move(on_overrun))
+        , lane_items_(max_items)
+        , id_(next_queue_id_())
+    {}
+
+    spsc_lanes_queue(const spsc_lanes_queue &) = delete;
+    spsc_lanes_queue &operator=(const spsc_lanes_queue &) = delete;
+
+    ~spsc_lanes_queue()
+    {
+        std::lock_guard<std::mutex> lock(consumer_mutex_);
+        for (auto &l : lanes_)
+        {
+            l->detached.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // try to enqueue and block if no room left
+    void enqueue(T &&item)
+    {
+        lane *l = this_thread_lane_();
+        if (l == nullptr)
+        {
+            enqueue_exiting_(item);
+        }
+        else
+        {
+            auto stamp = now_stamp_();
+            if (!spin_.until([l, &item, stamp] { return l->try_push(item, stamp); }))
+            {
+                std::unique_lock<std::mutex> lock(park_mutex_);
+                waiting_producers_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                pop_cv_.wait(lock, [l, &item, stamp] { return l->try_push(item, stamp); });
+                waiting_producers_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        notify_consumers_();
+    }
+
+    // enqueue immediately. overrun oldest message in the caller's lane if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        lane *l = this_thread_lane_();
+        if (l == nullptr)
+        {
+            enqueue_exiting_(item);
+        }
+        else
+        {
+            auto stamp = now_stamp_();
+            while (!l->try_push(item, stamp))
+            {
+                std::lock_guard<std::mutex> lock(consumer_mutex_);
+                if (slot *overrun_slot = l->front())
+                {
+                    if (on_overrun_)
+                    {
+                        on_overrun_(overrun_slot->item);
+                    }
+                    l->pop_front();
+                    overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        notify_consumers_();
+    }
+
+    // enqueue if there is room in the caller's lane. Return true, if succeeded
+    bool try_enqueue(T &&item)
+    {
+        lane *l = this_thread_lane_();
+        if (l == nullptr)
+        {
+            enqueue_exiting_(item);
+        }
+        else if (!l->try_push(item, now_stamp_()))
+        {
+            return false;
+        }
+        notify_consumers_();
+        return true;
+    }
+
+    // try to dequeue item. if no item found. wait up to timeout and try again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        bool dequeued = spin_.until([this, &popped_item] {
+            std::lock_guard<std::mutex> lock(this->consumer_mutex_);
+            return this->try_dequeue_(popped_item);
+        });
+        if (!dequeued)
+        {
+            std::unique_lock<std::mutex> lock(park_mutex_);
+            waiting_consumers_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            dequeued = push_cv_.wait_for(lock, wait_duration, [this, &popped_item] {
+                std::lock_guard<std::mutex> consumer_lock(this->consumer_mutex_);
+                return this->try_dequeue_(popped_item);
+            });
+            waiting_consumers_.fetch_sub(1, std::memory_order_relaxed);
+            if (!dequeued)
+            {
+                return false;
+            }
+        }
+        notify_producers_();
+        return true;
+    }
+
+    // try to dequeue up to max_items items. if no item found. wait up to timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        if (max_items == 0 || !dequeue_for(popped_items[0], wait_duration))
+        {
+            return 0;
+        }
+        size_t n = 1;
+        {
+            std::lock_guard<std::mutex> lock(consumer_mutex_);
+            while (n < max_items && try_dequeue_(popped_items[n]))
+            {
+                n++;
+            }
+        }
+        if (n > 1)
+        {
+            notify_producers_();
+        }
+        return n;
+    }
+
+    // dequeue up to max_items items without waiting
+    // Return the number of dequeued items
+    size_t try_dequeue_bulk(T *popped_items, size_t max_items)
+    {
+        size_t n = 0;
+        {
+            std::lock_guard<std::mutex> lock(consumer_mutex_);
+            while (n < max_items && try_dequeue_(popped_items[n]))
+            {
+                n++;
+            }
+        }
+        if (n > 0)
+        {
+            notify_producers_();
+        }
+        return n;
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+    // total number of messages in all lanes
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(consumer_mutex_);
+        size_t total = 0;
+        for (auto &l : lanes_)
+        {
+            total += l->size();
+        }
+        return total;
+    }
+
+    void reset_overrun_counter()
+    {
+        overrun_counter_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    using stamp_type = std::chrono::steady_clock::rep;
+
+    static stamp_type now_stamp_()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    struct slot
+    {
+        T item;
+        stamp_type stamp = 0;
+    };
+
+    // lamport ring. one slot is reserved as marker for full lane.
+    struct lane
+    {
+        explicit lane(size_t max_items)
+            : capacity(max_items + 1)
+            , slots(capacity)
+        {}
+
+        bool try_push(T &item, stamp_type stamp)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t next = t + 1 == capacity ? 0 : t + 1;
+            if (next == cached_head)
+            {
+                cached_head = head.load(std::memory_order_acquire);
+                if (next == cached_head)
+                {
+                    return false;
+                }
+            }
+            slots[t].item = std::move(item);
+            slots[t].stamp = stamp;
+            tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side (under the consumer mutex)
+        slot *front()
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            return h == tail.load(std::memory_order_acquire) ? nullptr : &slots[h];
+        }
+
+        void pop_front()
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            head.store(h + 1 == capacity ? 0 : h + 1, std::memory_order_release);
+        }
+
+        size_t size() const
+        {
+            size_t h = head.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_acquire);
+            return t >= h ? t - h : capacity - (h - t);
+        }
+
+        const size_t capacity;
+        std::vector<slot> slots;
+        std::atomic<bool> closed{false};   // the producer thread has exited
+        std::atomic<bool> detached{false}; // the queue has been destroyed
+
+        char pad0_[cache_line_size];
+        std::atomic<size_t> tail{0}; // written by the producer
+        size_t cached_head = 0;      // producer's copy of head
+        char pad1_[cache_line_size];
+        std::atomic<size_t> head{0}; // written by the consumers
+        char pad2_[cache_line_size];
+    };
+
+    using lane_ptr = std::shared_ptr<lane>;
+
+    // the lanes this thread produces to (one per queue). lanes are closed when the thread exits.
+    struct thread_lanes
+    {
+        std::vector<std::pair<size_t, lane_ptr>> lanes;
+        size_t last_id = 0;
+        lane *last_lane = nullptr;
+
+        ~thread_lanes()
+        {
+            thread_exiting_() = true;
+            for (auto &l : lanes)
+            {
+                l.second->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    // set once the thread's lanes were destroyed (e.g. a pool destructed by a static
+    // destructor after main() returned). trivially destructible, so always safe to read.
+    static bool &thread_exiting_()
+    {
+        static thread_local bool exiting = false;
+        return exiting;
+    }
+
+    static size_t next_queue_id_()
+    {
+        static std::atomic<size_t> id_counter{0};
+        return ++id_counter;
+    }
+
+    // return the lane of the calling thread, registering it if needed.
+    // return nullptr if the thread is exiting and its lanes are gone.
+    lane *this_thread_lane_()
+    {
+        if (thread_exiting_())
+        {
+            return nullptr;
+        }
+        static thread_local thread_lanes tls;
+        if (tls.last_id == id_)
+        {
+            return tls.last_lane;
+        }
+
+        lane *found = nullptr;
+        for (auto it = tls.lanes.begin(); it != tls.lanes.end();)
+        {
+            if (it->first == id_)
+            {
+                found = it->second.get();
+            }
+            // forget lanes of destroyed queues
+            if (it->second->detached.load(std::memory_order_relaxed))
+            {
+                it = tls.lanes.erase(it);
+                continue;
+            }
+            ++it;
+        }
+
+        if (found == nullptr)
+        {
+            auto new_lane = std::make_shared<lane>(lane_items_);
+            {
+                std::lock_guard<std::mutex> lock(consumer_mutex_);
+                lanes_.push_back(new_lane);
+            }
+            found = new_lane.get();
+            tls.lanes.emplace_back(id_, std::move(new_lane));
+        }
+        tls.last_id = id_;
+        tls.last_lane = found;
+        return found;
+    }
+
+    // an exiting thread posts through a single-use lane, closed right away.
+    void enqueue_exiting_(T &item)
+    {
+        auto single_use = std::make_shared<lane>(1);
+        single_use->try_push(item, now_stamp_());
+        single_use->closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(consumer_mutex_);
+        lanes_.push_back(std::move(single_use));
+    }
+
+    // pop the oldest lane head and reclaim drained lanes of exited threads.
+    // must be called under the consumer mutex.
+    bool try_dequeue_(T &popped_item)
+    {
+        lane *oldest = nullptr;
+        slot *oldest_slot = nullptr;
+        for (size_t i = 0; i < lanes_.size();)
+        {
+            lane *l = lanes_[i].get();
+            // check closed before front(), so that no item pushed before closing is missed
+            bool closed = l->closed.load(std::memory_order_acquire);
+            slot *head_slot = l->front();
+            if (head_slot == nullptr)
+            {
+                if (closed)
+                {
+                    lanes_[i] = std::move(lanes_.back());
+                    lanes_.pop_back();
+                    continue;
+                }
+            }
+            else if (oldest_slot == nullptr || head_slot->stamp < oldest_slot->stamp)
+            {
+                oldest = l;
+                oldest_slot = head_slot;
+            }
+            ++i;
+        }
+
+        if (oldest == nullptr)
+        {
+            return false;
+        }
+        popped_item = std::move(oldest_slot->item);
+        oldest->pop_front();
+        return true;
+    }
+
+    // the fence pairs with the one taken by a parking thread after it registered
+    // itself as waiting: either we see the waiter, or the waiter sees our item.
+    void notify_consumers_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_consumers_.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex_);
+            }
+            push_cv_.notify_one();
+        }
+    }
+
+    // blocked producers wait for room in different lanes, so wake them all.
+    void notify_producers_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_producers_.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex_);
+            }
+            pop_cv_.notify_all();
+        }
+    }
+
+    const spin_wait spin_;
+    const std::function<void(T &)> on_overrun_;
+    const size_t lane_items_;
+    const size_t id_;
+    std::mutex consumer_mutex_;
+    std::vector<lane_ptr> lanes_;
+    std::atomic<size_t> overrun_counter_{0};
+
+    std::atomic<size_t> waiting_consumers_{0};
+    std::atomic<size_t> waiting_producers_{0};
+    std::mutex park_mutex_;
+    std::condition_variable push_cv_;
+    std::condition_variable pop_cv_;
+};
+} // namespace details
+} // namespace spdlog
@@ -4,30 +4,63 @@
 #pragma once
 
 #include <spdlog/common.h>
+
+#include <algorithm>
 #include <cassert>
 
 namespace spdlog {
 namespace details {
 
-inline thread_pool::thread_pool(
-    size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start, std::function<void()> on_thread_stop)
-    : q_(q_max_items)
+inline thread_pool::thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start,
+    std::function<void()> on_thread_stop, const thread_pool_options &options)
+    : threads_per_shard_(threads_n)
+    , max_batch_size_(options.max_batch_size)
+    , priority_level_(options.priority_level)
 {
     if (threads_n == 0 || threads_n > 1000)
     {
         throw_spdlog_ex("spdlog::thread_pool(): invalid threads_n param (valid "
                         "range is 1-1000)");
     }
-    for (size_t i = 0; i < threads_n; i++)
+    if (options.shards == 0 || options.shards * threads_n > 1000)
+    {
+        throw_spdlog_ex("spdlog::thread_pool(): invalid shards param (valid "
+                        "range is 1-1000 threads in total)");
+    }
+    if (max_batch_size_ == 0)
+    {
+        throw_spdlog_ex("spdlog::thread_pool(): max_batch_size cannot be zero");
+    }
+    if (priority_level_ != level::off && options.priority_q_size == 0)
     {
-        threads_.emplace_back([this, on_thread_start, on_thread_stop] {
+        throw_spdlog_ex("spdlog::thread_pool(): priority_q_size cannot be zero");
+    }
+    for (size_t i = 0; i < options.shards; i++)
+    {
+        queues_.push_back(make_queue_(q_max_items, options));
+        if (priority_level_ != level::off)
+        {
+            priority_queues_.push_back(make_queue_(options.priority_q_size, options));
+        }
+    }
+
+    size_t total_threads = options.shards * threads_n;
+    for (size_t i = 0; i < total_threads; i++)
+    {
+        threads_.emplace_back([this, i, on_thread_start, on_thread_stop, options] {
+            setup_worker_thread_(options, i);
             on_thread_start();
-            this->thread_pool::worker_loop_();
+            this->thread_pool::worker_loop_(i);
             on_thread_stop();
         });
     }
 }
 
+inline thread_pool::thread_pool(
+    size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start, std::function<void()> on_thread_stop)
+    : thread_pool(q_max_items, threads_n, std::move(on_thread_start), std::move(on_thread_stop), thread_pool_options{})
+{}
+
 inline thread_pool::thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start)
     : thread_pool(q_max_items, threads_n, on_thread_start, [] {})
 {}
@@ -44,7 +77,7 @@ inline thread_pool::~thread_pool()
     {
         for (size_t i = 0; i < threads_.size(); i++)
         {
-            post_async_msg_(async_msg(async_msg_type::terminate), async_overflow_policy::block);
+            post_async_msg_(*queues_[i / threads_per_shard_], async_msg(async_msg_type::terminate), async_overflow_policy::block);
         }
 
         for (auto &t : threads_)
@@ -55,82 +88,536 @@ inline thread_pool::~thread_pool()
     catch (const std::exception &) {}
 }
 
-void inline thread_pool::post_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy)
+void inline thread_pool::register_logger(async_logger_ptr logger)
+{
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    if (!logger->registered_.load(std::memory_order_relaxed))
+    {
+        logger->registered_.store(true, std::memory_order_relaxed);
+        loggers_.push_back(std::move(logger));
+    }
+}
+
+bool inline thread_pool::post_log(
+    async_logger *worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy, async_msg_type msg_type)
 {
-    async_msg async_m(std::move(worker_ptr), async_msg_type::log, msg);
-    post_async_msg_(std::move(async_m), overflow_policy);
+    async_msg own_msg;
+    async_msg *new_msg = thread_msg_();
+    if (new_msg == nullptr)
+    {
+        new_msg = &own_msg;
+    }
+    new_msg->assign(worker_ptr, msg_type, msg);
+
+    count_posts_(*worker_ptr, 1);
+    bool queued;
+    if (priority_queues_.empty() || msg.level < priority_level_)
+    {
+        queued = post_async_msg_(shard_queue_(worker_ptr), std::move(*new_msg), overflow_policy);
+    }
+    else
+    {
+        size_t shard = shard_of(*worker_ptr);
+        queued = post_async_msg_(*priority_queues_[shard], std::move(*new_msg), overflow_policy);
+        // wake up a worker parked on the regular queue. if that queue is full no worker is parked anyway.
+        queues_[shard]->try_enqueue(async_msg(async_msg_type::wakeup));
+    }
+    if (!queued)
+    {
+        count_posts_(*worker_ptr, -1);
+    }
+    return queued;
 }
 
-void inline thread_pool::post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy)
+bool inline thread_pool::post_flush(async_logger *worker_ptr, async_overflow_policy overflow_policy)
 {
-    post_async_msg_(async_msg(std::move(worker_ptr), async_msg_type::flush), overflow_policy);
+    count_posts_(*worker_ptr, 1);
+    if (!post_async_msg_(shard_queue_(worker_ptr), async_msg(worker_ptr, async_msg_type::flush), overflow_policy))
+    {
+        count_posts_(*worker_ptr, -1);
+        return false;
+    }
+    return true;
 }
 
 size_t inline thread_pool::overrun_counter()
 {
-    return q_.overrun_counter();
+    size_t total = 0;
+    for (size_t shard = 0; shard < queues_.size(); shard++)
+    {
+        total += overrun_counter(shard);
+    }
+    return total;
+}
+
+size_t inline thread_pool::overrun_counter(size_t shard)
+{
+    size_t overruns = queue_at_(shard).overrun_counter();
+    if (!priority_queues_.empty())
+    {
+        overruns += priority_queues_[shard]->overrun_counter();
+    }
+    return overruns;
 }
 
 void inline thread_pool::reset_overrun_counter()
 {
-    q_.reset_overrun_counter();
+    for (auto &q : queues_)
+    {
+        q->reset_overrun_counter();
+    }
+    for (auto &q : priority_queues_)
+    {
+        q->reset_overrun_counter();
+    }
 }
 
 size_t inline thread_pool::queue_size()
 {
-    return q_.size();
+    size_t total = 0;
+    for (size_t shard = 0; shard < queues_.size(); shard++)
+    {
+        total += queue_size(shard);
+    }
+    return total;
+}
+
+size_t inline thread_pool::queue_size(size_t shard)
+{
+    size_t size = queue_at_(shard).size();
+    if (!priority_queues_.empty())
+    {
+        size += priority_queues_[shard]->size();
+    }
+    return size;
+}
+
+size_t inline thread_pool::shards() const
+{
+    return queues_.size();
+}
+
+size_t inline thread_pool::shard_of(async_logger &logger)
+{
+    size_t shard = logger.shard_.load(std::memory_order_relaxed);
+    if (shard == 0)
+    {
+        try_set_shard_(logger, group_shard_(logger.name())); // may lose to set_shard(..) in another thread
+        shard = logger.shard_.load(std::memory_order_relaxed);
+    }
+    return shard - 1;
+}
+
+void inline thread_pool::set_shard(async_logger &logger, size_t shard)
+{
+    queue_at_(shard); // throw on an invalid index
+    if (!try_set_shard_(logger, shard))
+    {
+        throw_spdlog_ex("async_logger: the shard can be set only once, before the logger is used");
+    }
+}
+
+void inline thread_pool::set_shard_group(async_logger &logger, const std::string &group)
+{
+    if (logger.shard_.load(std::memory_order_relaxed) != 0 || !try_set_shard_(logger, group_shard_(group)))
+    {
+        throw_spdlog_ex("async_logger: the shard can be set only once, before the logger is used");
+    }
+}
+
+inline thread_pool::q_type &thread_pool::queue_at_(size_t shard)
+{
+    if (shard >= queues_.size())
+    {
+        throw_spdlog_ex("spdlog::thread_pool: invalid shard index");
+    }
+    return *queues_[shard];
+}
+
+inline thread_pool::q_type &thread_pool::shard_queue_(async_logger *logger)
+{
+    return *queues_[shard_of(*logger)];
+}
+
+size_t inline thread_pool::group_shard_(const std::string &group)
+{
+    std::lock_guard<std::mutex> lock(shards_mutex_);
+    auto it = group_shards_.find(group);
+    if (it == group_shards_.end())
+    {
+        it = group_shards_.emplace(group, next_shard_).first;
+        next_shard_ = (next_shard_ + 1) % queues_.size();
+    }
+    return it->second;
+}
+
+bool inline thread_pool::try_set_shard_(async_logger &logger, size_t shard)
+{
+    size_t unset = 0;
+    return logger.shard_.compare_exchange_strong(unset, shard + 1, std::memory_order_relaxed);
+}
+
+inline std::unique_ptr<thread_pool::q_type> thread_pool::make_queue_(size_t q_max_items, const thread_pool_options &options)
+{
+    spin_wait spin;
+    if (options.wait_strategy == async_wait_strategy::spin_then_park)
+    {
+        spin = spin_wait{options.spin_count, options.yield_count};
+    }
+    // an overrun message will never be processed
+    auto on_overrun = [](item_type &overrun_msg) {
+        if (overrun_msg.worker_ptr != nullptr)
+        {
+            done_with_(overrun_msg.worker_ptr, 1);
+        }
+    };
+
+    switch (options.queue_type)
+    {
+    case async_queue_type::lock_free:
+        if (q_max_items == 0)
+        {
+            throw_spdlog_ex("spdlog::thread_pool(): lock free queue size cannot be zero");
+        }
+        return details::make_unique<async_queue_impl<mpmc_lockfree_queue<item_type>>>(q_max_items, spin, on_overrun);
+    case async_queue_type::per_thread_lanes:
+        if (q_max_items == 0)
+        {
+            throw_spdlog_ex("spdlog::thread_pool(): lane size cannot be zero");
+        }
+        return details::make_unique<async_queue_impl<spsc_lanes_queue<item_type>>>(q_max_items, spin, on_overrun);
+    case async_queue_type::elastic:
+        if (q_max_items == 0 || options.elastic_segment_size == 0)
+        {
+            throw_spdlog_ex("spdlog::thread_pool(): elastic queue size and segment size cannot be zero");
+        }
+        return details::make_unique<async_queue_impl<elastic_queue<item_type>>>(
+            q_max_items, spin, (std::min)(options.elastic_segment_size, q_max_items), options.elastic_shrink_after, on_overrun);
+    case async_queue_type::blocking:
+    default:
+        return details::make_unique<async_queue_impl<mpmc_blocking_queue<item_type>>>(q_max_items, spin, on_overrun);
+    }
+}
+
+inline async_msg *thread_pool::thread_msg_()
+{
+#ifdef SPDLOG_NO_TLS
+    return nullptr;
+#else
+    // trivially destructible, so always safe to read
+    static thread_local bool exiting = false;
+    struct tls_msg
+    {
+        async_msg msg;
+        ~tls_msg()
+        {
+            exiting = true;
+        }
+    };
+    if (exiting)
+    {
+        return nullptr;
+    }
+    static thread_local tls_msg tls;
+    return &tls.msg;
+#endif
+}
+
+bool inline thread_pool::post_async_msg_(q_type &q, async_msg &&new_msg, async_overflow_policy overflow_policy)
+{
+    switch (overflow_policy)
+    {
+    case async_overflow_policy::block:
+        q.enqueue(std::move(new_msg));
+        return true;
+    case async_overflow_policy::discard_new:
+        return q.try_enqueue(std::move(new_msg));
+    case async_overflow_policy::overrun_oldest:
+    default:
+        q.enqueue_nowait(std::move(new_msg));
+        return true;
+    }
 }
 
-void inline thread_pool::post_async_msg_(async_msg &&new_msg, async_overflow_policy overflow_policy)
+// counted before the message is queued, so the processed messages never outnumber the posted ones
+void inline thread_pool::count_posts_(async_logger &logger, int n_msgs)
 {
-    if (overflow_policy == async_overflow_policy::block)
+    post_counter *counter = post_counter_(logger);
+    if (counter == nullptr)
+    {
+        logger.shared_posted_.fetch_add(static_cast<size_t>(n_msgs), std::memory_order_relaxed);
+    }
+    else if (n_msgs > 0)
     {
-        q_.enqueue(std::move(new_msg));
+        counter->add(static_cast<size_t>(n_msgs));
     }
     else
     {
-        q_.enqueue_nowait(std::move(new_msg));
+        counter->remove(static_cast<size_t>(-n_msgs));
+    }
+}
+
+inline post_counter *thread_pool::post_counter_(async_logger &logger)
+{
+#ifdef SPDLOG_NO_TLS
+    (void)logger;
+    return nullptr;
+#else
+    // trivially destructible, so always safe to read
+    static thread_local bool exiting = false;
+    struct thread_counters
+    {
+        std::uint64_t last_id = 0;
+        post_counter *last = nullptr;
+        std::vector<std::pair<std::uint64_t, std::shared_ptr<post_counter>>> counters; // by logger id
+        size_t prune_at = 8;
+        ~thread_counters()
+        {
+            exiting = true;
+        }
+    };
+    if (exiting)
+    {
+        return nullptr;
+    }
+    static thread_local thread_counters tls;
+    if (tls.last_id == logger.id_)
+    {
+        return tls.last;
+    }
+
+    post_counter *found = nullptr;
+    for (auto &entry : tls.counters)
+    {
+        if (entry.first == logger.id_)
+        {
+            found = entry.second.get();
+            break;
+        }
     }
+    if (found == nullptr)
+    {
+        // forget the counters of destroyed loggers from time to time
+        if (tls.counters.size() >= tls.prune_at)
+        {
+            tls.counters.erase(std::remove_if(tls.counters.begin(), tls.counters.end(),
+                                   [](const std::pair<std::uint64_t, std::shared_ptr<post_counter>> &entry) {
+                                       return entry.second->logger_gone.load(std::memory_order_relaxed);
+                                   }),
+                tls.counters.end());
+            tls.prune_at = (std::max)(tls.counters.size() * 2, size_t{8});
+        }
+        auto counter = std::make_shared<post_counter>();
+        {
+            std::lock_guard<std::mutex> lock(logger.post_counters_mutex_);
+            logger.post_counters_.push_back(counter);
+        }
+        found = counter.get();
+        tls.counters.emplace_back(logger.id_, std::move(counter));
+    }
+    tls.last_id = logger.id_;
+    tls.last = found;
+    return found;
+#endif
 }
 
-void inline thread_pool::worker_loop_()
+size_t inline thread_pool::posted_count_(async_logger &logger)
 {
-    while (process_next_msg_()) {}
+    size_t posted = logger.shared_posted_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(logger.post_counters_mutex_);
+    for (auto &counter : logger.post_counters_)
+    {
+        posted += counter->posted.load(std::memory_order_relaxed);
+    }
+    return posted;
+}
+
+// per batch of messages of the logger.
+// the release pairs with the acquire in release_orphans_(..): the logger is destroyed only after
+// the workers are done with it
+void inline thread_pool::done_with_(async_logger *logger, size_t n_msgs)
+{
+    logger->processed_.fetch_add(n_msgs, std::memory_order_release);
 }
 
-// process next message in the queue
+void inline thread_pool::setup_worker_thread_(const thread_pool_options &options, size_t worker_index)
+{
+    if (!options.cpu_affinity.empty())
+    {
+        os::set_thread_affinity(options.cpu_affinity);
+    }
+    if (!options.thread_name.empty())
+    {
+        // keep the index visible when the name gets truncated
+        auto index = std::to_string(worker_index);
+        auto max_base = index.size() < 15 ? 15 - index.size() : 0;
+        os::set_thread_name(options.thread_name.substr(0, max_base) + index);
+    }
+    if (options.nice_increment != 0)
+    {
+        os::set_thread_nice(options.nice_increment);
+    }
+    if (options.sched_idle)
+    {
+        os::set_thread_sched_idle();
+    }
+}
+
+void inline thread_pool::worker_loop_(size_t worker_index)
+{
+    worker_buffers buffers;
+    buffers.batch.resize(max_batch_size_);
+    buffers.run.reserve(max_batch_size_);
+    while (process_next_batch_(worker_index, buffers)) {}
+}
+
+// process the next batch of messages in the queue
 // return true if this thread should still be active (while no terminate msg
 // was received)
-bool inline thread_pool::process_next_msg_()
+bool inline thread_pool::process_next_batch_(size_t worker_index, worker_buffers &buffers)
 {
-    async_msg incoming_async_msg;
-    bool dequeued = q_.dequeue_for(incoming_async_msg, std::chrono::seconds(10));
-    if (!dequeued)
+    auto &batch = buffers.batch;
+    auto &run = buffers.run;
+    size_t shard = worker_index / threads_per_shard_;
+    q_type &q = *queues_[shard];
+    q_type *priority_q = priority_queues_.empty() ? nullptr : priority_queues_[shard].get();
+
+    // the priority queue is always drained first
+    size_t n = priority_q != nullptr ? priority_q->try_dequeue_bulk(batch.data(), batch.size()) : 0;
+    if (n == 0)
     {
-        return true;
+        n = q.dequeue_bulk_for(batch.data(), batch.size(), buffers.idle_wait);
     }
+    // look for dropped loggers soon after the last messages, then less and less often
+    buffers.idle_wait = n > 0 ? std::chrono::milliseconds(1) : (std::min)(buffers.idle_wait * 2, std::chrono::milliseconds(1000));
 
-    switch (incoming_async_msg.msg_type)
+    bool active = true;
+    size_t i = 0;
+    while (i < n)
     {
-    case async_msg_type::log: {
-        incoming_async_msg.worker_ptr->backend_sink_it_(incoming_async_msg);
-        return true;
+        async_msg &incoming_async_msg = batch[i];
+        switch (incoming_async_msg.msg_type)
+        {
+        case async_msg_type::log:
+        case async_msg_type::deferred_log: {
+            // hand consecutive messages of the same logger to its sinks at once
+            async_logger *logger = incoming_async_msg.worker_ptr;
+            size_t run_size = 0;
+            run.clear();
+            while (i < n && (batch[i].msg_type == async_msg_type::log || batch[i].msg_type == async_msg_type::deferred_log) &&
+                   batch[i].worker_ptr == logger)
+            {
+                if (prepare_log_msg_(batch[i], buffers))
+                {
+                    run.push_back(batch[i]);
+                }
+                run_size++;
+                i++;
+            }
+            if (!run.empty())
+            {
+                logger->backend_sink_batch_(run.data(), run.size());
+            }
+            done_with_(logger, run_size);
+            continue;
+        }
+        case async_msg_type::flush: {
+            incoming_async_msg.worker_ptr->backend_flush_();
+            done_with_(incoming_async_msg.worker_ptr, 1);
+            break;
+        }
+
+        case async_msg_type::wakeup: {
+            break;
+        }
+
+        case async_msg_type::terminate: {
+            drain_priority_queue_(priority_q, buffers);
+            // every worker is sent its own terminate message - give back the ones meant for the others
+            if (active)
+            {
+                active = false;
+            }
+            else
+            {
+                post_async_msg_(q, async_msg(async_msg_type::terminate), async_overflow_policy::block);
+            }
+            break;
+        }
+
+        default: {
+            assert(false);
+        }
+        }
+        i++;
     }
-    case async_msg_type::flush: {
-        incoming_async_msg.worker_ptr->backend_flush_();
-        return true;
+
+    // look for dropped loggers once the queue was drained, and from time to time when busy
+    if (n < batch.size() || (++buffers.full_batches & 1023) == 0)
+    {
+        release_orphans_();
     }
+    return active;
+}
 
-    case async_msg_type::terminate: {
-        return false;
+bool inline thread_pool::prepare_log_msg_(async_msg &msg, worker_buffers &buffers)
+{
+    if (msg.msg_type != async_msg_type::deferred_log)
+    {
+        return true;
     }
+    msg.msg_type = async_msg_type::log;
+    return msg.worker_ptr->backend_format_(msg, buffers.formatter, buffers.formatted);
+}
 
-    default: {
-        assert(false);
+// process what is left in the priority queue, one message at a time
+void inline thread_pool::drain_priority_queue_(q_type *priority_q, worker_buffers &buffers)
+{
+    if (priority_q == nullptr)
+    {
+        return;
     }
+    async_msg incoming_async_msg;
+    while (priority_q->try_dequeue_bulk(&incoming_async_msg, 1) == 1)
+    {
+        if (prepare_log_msg_(incoming_async_msg, buffers))
+        {
+            log_msg msg = incoming_async_msg;
+            incoming_async_msg.worker_ptr->backend_sink_batch_(&msg, 1);
+        }
+        done_with_(incoming_async_msg.worker_ptr, 1);
     }
+}
 
-    return true;
+void inline thread_pool::release_orphans_()
+{
+    std::vector<async_logger_ptr> released;
+    {
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        for (size_t i = 0; i < loggers_.size();)
+        {
+            auto &logger = loggers_[i];
+            // the flag is cleared first, so a logger resurrected from a weak_ptr registers itself again.
+            // with no other reference, no message can be posted anymore - once none is in flight, the
+            // workers are done with the logger.
+            logger->registered_.store(false, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool orphan = logger.use_count() == 1;
+            // pairs with the release of the last other reference, which was dropped after posting
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // with no other reference, no thread posts anymore: the counts are final
+            if (orphan && logger->processed_.load(std::memory_order_acquire) == posted_count_(*logger))
+            {
+                released.push_back(std::move(logger));
+                loggers_[i] = std::move(loggers_.back());
+                loggers_.pop_back();
+                continue;
+            }
+            logger->registered_.store(true, std::memory_order_relaxed);
+            ++i;
+        }
+    }
+    // the loggers (and possibly their sinks) are destroyed here, outside the lock
 }
 
 } // namespace details
@@ -3,13 +3,21 @@
 
 #pragma once
 
-#include <spdlog/details/log_msg_buffer.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/elastic_q.h>
 #include <spdlog/details/mpmc_blocking_q.h>
+#include <spdlog/details/mpmc_lockfree_q.h>
+#include <spdlog/details/spsc_lanes_q.h>
 #include <spdlog/details/os.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <functional>
 
@@ -23,49 +31,193 @@ using async_logger_ptr = std::shared_ptr<spdlog::async_logger>;
 enum class async_msg_type
 {
     log,
+    deferred_log, // to be formatted from the captured arguments (see details::encode_deferred(..))
     flush,
+    wakeup,  // a message was posted to the priority queue
     terminate
 };
 
-// Async msg to move to/from the queue
-// Movable only. should never be copied
-struct async_msg : log_msg_buffer
+// Async msg to move to/from the queue.
+// The queue slots are preallocated and reused: moving a message swaps its storage with the
+// destination's, so both keep their capacity for the next messages (nothing is copied or allocated).
+// The content is copied once, by assign(..), into the posting thread's message (see thread_pool::post_log(..)).
+// The logger is referred by raw pointer - it is kept alive by the thread pool while it has messages
+// in flight (see thread_pool::register_logger(..)).
+struct async_msg : log_msg
 {
     async_msg_type msg_type{async_msg_type::log};
-    async_logger_ptr worker_ptr;
+    async_logger *worker_ptr{nullptr};
 
     async_msg() = default;
     ~async_msg() = default;
 
     // should only be moved in or out of the queue..
     async_msg(const async_msg &) = delete;
-    async_msg(async_msg &&) = default;
-    async_msg &operator=(async_msg &&) = default;
-
-    // construct from log_msg with given type
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type, const details::log_msg &m)
-        : log_msg_buffer{m}
-        , msg_type{the_type}
-        , worker_ptr{std::move(worker)}
+    async_msg &operator=(const async_msg &) = delete;
+
+    // the string views point into the storage, which keeps its address when moved
+    async_msg(async_msg &&other) noexcept
+        : log_msg{other}
+        , msg_type{other.msg_type}
+        , worker_ptr{other.worker_ptr}
+        , buffer_{std::move(other.buffer_)}
     {}
 
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type)
-        : log_msg_buffer{}
-        , msg_type{the_type}
-        , worker_ptr{std::move(worker)}
+    // the moved from message is left with the previous content of this one
+    async_msg &operator=(async_msg &&other) noexcept
+    {
+        std::swap(static_cast<log_msg &>(*this), static_cast<log_msg &>(other));
+        std::swap(msg_type, other.msg_type);
+        std::swap(worker_ptr, other.worker_ptr);
+        buffer_.swap(other.buffer_);
+        return *this;
+    }
+
+    async_msg(async_logger *worker, async_msg_type the_type)
+        : msg_type{the_type}
+        , worker_ptr{worker}
     {}
 
     explicit async_msg(async_msg_type the_type)
         : async_msg{nullptr, the_type}
     {}
+
+    // copy the given message into this one, reusing its storage
+    void assign(async_logger *worker, async_msg_type the_type, const details::log_msg &m)
+    {
+        log_msg::operator=(m);
+        msg_type = the_type;
+        worker_ptr = worker;
+        buffer_.clear();
+        buffer_.insert(buffer_.end(), logger_name.begin(), logger_name.end());
+        buffer_.insert(buffer_.end(), captured_args.begin(), captured_args.end());
+        buffer_.insert(buffer_.end(), payload.begin(), payload.end());
+        update_string_views_();
+    }
+
+    // replace the payload (which must not point into this message)
+    void set_payload(string_view_t new_payload)
+    {
+        buffer_.resize(logger_name.size() + captured_args.size());
+        buffer_.insert(buffer_.end(), new_payload.begin(), new_payload.end());
+        payload = new_payload;
+        update_string_views_();
+    }
+
+private:
+    std::vector<char> buffer_; // a vector, so two messages can swap their storage without copying
+
+    void update_string_views_()
+    {
+        logger_name = string_view_t{buffer_.data(), logger_name.size()};
+        captured_args = string_view_t{buffer_.data() + logger_name.size(), captured_args.size()};
+        payload = string_view_t{buffer_.data() + logger_name.size() + captured_args.size(), payload.size()};
+    }
+};
+
+// The messages one thread posted for one async logger (see async_logger::processed_).
+// Written by that thread only, so counted without atomic read-modify-write, on cache lines of its own.
+// Shared by the thread and the logger, so either may go first.
+struct post_counter
+{
+    void add(size_t n)
+    {
+        posted.store(posted.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void remove(size_t n)
+    {
+        posted.store(posted.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+    }
+
+    char pad0_[cache_line_size];
+    std::atomic<size_t> posted{0};
+    std::atomic<bool> logger_gone{false}; // set when the logger is destroyed - the thread forgets the counter
+    char pad1_[cache_line_size];
+};
+
+// Common interface of the queues the thread pool can be configured with.
+class async_queue
+{
+public:
+    virtual ~async_queue() = default;
+    virtual void enqueue(async_msg &&item) = 0;
+    virtual void enqueue_nowait(async_msg &&item) = 0;
+    virtual bool try_enqueue(async_msg &&item) = 0;
+    virtual bool dequeue_for(async_msg &popped_item, std::chrono::milliseconds wait_duration) = 0;
+    virtual size_t dequeue_bulk_for(async_msg *popped_items, size_t max_items, std::chrono::milliseconds wait_duration) = 0;
+    virtual size_t try_dequeue_bulk(async_msg *popped_items, size_t max_items) = 0;
+    virtual size_t overrun_counter() = 0;
+    virtual void reset_overrun_counter() = 0;
+    virtual size_t size() = 0;
+};
+
+template<typename Q>
+class async_queue_impl final : public async_queue
+{
+public:
+    template<typename... Args>
+    explicit async_queue_impl(Args &&...args)
+        : q_(std::forward<Args>(args)...)
+    {}
+
+    void enqueue(async_msg &&item) override
+    {
+        q_.enqueue(std::move(item));
+    }
+
+    void enqueue_nowait(async_msg &&item) override
+    {
+        q_.enqueue_nowait(std::move(item));
+    }
+
+    bool try_enqueue(async_msg &&item) override
+    {
+        return q_.try_enqueue(std::move(item));
+    }
+
+    bool dequeue_for(async_msg &popped_item, std::chrono::milliseconds wait_duration) override
+    {
+        return q_.dequeue_for(popped_item, wait_duration);
+    }
+
+    size_t dequeue_bulk_for(async_msg *popped_items, size_t max_items, std::chrono::milliseconds wait_duration) override
+    {
+        return q_.dequeue_bulk_for(popped_items, max_items, wait_duration);
+    }
+
+    size_t try_dequeue_bulk(async_msg *popped_items, size_t max_items) override
+    {
+        return q_.try_dequeue_bulk(popped_items, max_items);
+    }
+
+    size_t overrun_counter() override
+    {
+        return q_.overrun_counter();
+    }
+
+    void reset_overrun_counter() override
+    {
+        q_.reset_overrun_counter();
+    }
+
+    size_t size() override
+    {
+        return q_.size();
+    }
+
+private:
+    Q q_;
 };
 
 class thread_pool
 {
 public:
     using item_type = async_msg;
-    using q_type = details::mpmc_blocking_queue<item_type>;
+    using q_type = async_queue;
 
+    thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start, std::function<void()> on_thread_stop,
+        const thread_pool_options &options);
     thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start, std::function<void()> on_thread_stop);
     thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start);
     thread_pool(size_t q_max_items, size_t threads_n);
@@ -76,24 +228,96 @@ public:
     thread_pool(const thread_pool &) = delete;
     thread_pool &operator=(thread_pool &&) = delete;
 
-    void post_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy);
-    void post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy);
+    // keep the logger alive while it posts to this pool.
+    // it is released once the pool holds the only reference to it and none of its messages is in flight
+    // (queued, or being processed - see async_logger::processed_). the workers check for such loggers
+    // whenever they drain the queue, and while idle (after 1ms, then backing off to once a second).
+    void register_logger(async_logger_ptr logger);
+
+    // return false if the message was discarded (async_overflow_policy::discard_new and queue full)
+    bool post_log(async_logger *worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy,
+        async_msg_type msg_type = async_msg_type::log);
+    bool post_flush(async_logger *worker_ptr, async_overflow_policy overflow_policy);
+
+    // totals of all the shards
     size_t overrun_counter();
     void reset_overrun_counter();
     size_t queue_size();
 
+    // per shard stats (shard index is 0..shards()-1)
+    size_t overrun_counter(size_t shard);
+    size_t queue_size(size_t shard);
+    size_t shards() const;
+
+    // the shard the given logger posts to. set on first use if not set yet, to the shard of its name.
+    size_t shard_of(async_logger &logger);
+    // set the shard of a logger not used yet (see async_logger::set_shard(..), async_logger::set_shard_group(..))
+    void set_shard(async_logger &logger, size_t shard);
+    void set_shard_group(async_logger &logger, const std::string &group);
+
 private:
-    q_type q_;
+    // owned by each worker and reused between batches
+    struct worker_buffers
+    {
+        std::vector<async_msg> batch;
+        std::vector<log_msg> run;
+        deferred_formatter formatter;
+        memory_buf_t formatted;
+        std::chrono::milliseconds idle_wait{1}; // how long to wait for messages before looking for dropped loggers
+        size_t full_batches = 0;
+    };
+
+    // one queue per shard, each served by threads_per_shard_ workers
+    std::vector<std::unique_ptr<q_type>> queues_;
+    size_t threads_per_shard_;
+    size_t max_batch_size_;
+    // messages at or above priority_level_ go to the shard's priority queue (if enabled)
+    level::level_enum priority_level_;
+    std::vector<std::unique_ptr<q_type>> priority_queues_;
+
+    std::mutex loggers_mutex_;
+    std::vector<async_logger_ptr> loggers_;
+
+    // the shards of the logger names and groups, given round-robin
+    std::mutex shards_mutex_;
+    std::unordered_map<std::string, size_t> group_shards_;
+    size_t next_shard_ = 0;
 
     std::vector<std::thread> threads_;
 
-    void post_async_msg_(async_msg &&new_msg, async_overflow_policy overflow_policy);
-    void worker_loop_();
+    static std::unique_ptr<q_type> make_queue_(size_t q_max_items, const thread_pool_options &options);
+    // the calling thread's message to post - reused, so its storage (swapped with the queue slots)
+    // is allocated once. nullptr if not available (SPDLOG_NO_TLS, thread exiting).
+    static async_msg *thread_msg_();
+    bool post_async_msg_(q_type &q, async_msg &&new_msg, async_overflow_policy overflow_policy);
+    // count messages posted by the calling thread (negative - not queued after all)
+    static void count_posts_(async_logger &logger, int n_msgs);
+    // the calling thread's counter of the messages posted for the logger.
+    // nullptr if not available (SPDLOG_NO_TLS, thread exiting).
+    static post_counter *post_counter_(async_logger &logger);
+    // the messages posted for the logger, by all the threads
+    static size_t posted_count_(async_logger &logger);
+    // the message was processed, or overrun in the queue
+    static void done_with_(async_logger *logger, size_t n_msgs);
+    q_type &queue_at_(size_t shard);
+    q_type &shard_queue_(async_logger *logger);
+    size_t group_shard_(const std::string &group);
+    // return false if the logger's shard was already set
+    static bool try_set_shard_(async_logger &logger, size_t shard);
+    static void setup_worker_thread_(const thread_pool_options &options, size_t worker_index);
+    void worker_loop_(size_t worker_index);
 
-    // process next message in the queue
+    // process the next batch of messages in the queue.
     // return true if this thread should still be active (while no terminate msg
     // was received)
-    bool process_next_msg_();
+    bool process_next_batch_(size_t worker_index, worker_buffers &buffers);
+
+    // format a deferred_log message in place. return false if it cannot be formatted.
+    static bool prepare_log_msg_(async_msg &msg, worker_buffers &buffers);
+    void drain_priority_queue_(q_type *priority_q, worker_buffers &buffers);
+
+    // destroy the loggers only referenced by the pool, with no messages in flight
+    void release_orphans_();
 };
 
 } // namespace details
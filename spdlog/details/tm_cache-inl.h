@@ -0,0 +1,90 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/os.h>
+
+#include <cstring>
+#include <limits>
+
+namespace spdlog {
+namespace details {
+
+inline tm_cache::tm_cache(pattern_time_type time_type)
+    : time_type_(time_type)
+    , secs_(std::numeric_limits<long long>::min())
+{
+    for (auto &w : words_)
+    {
+        w.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline std::tm tm_cache::get(std::time_t t)
+{
+    std::tm tm_time;
+    if (try_read_(t, tm_time))
+    {
+        return tm_time;
+    }
+    tm_time = time_type_ == pattern_time_type::local ? os::localtime(t) : os::gmtime(t);
+    try_publish_(t, tm_time);
+    return tm_time;
+}
+
+inline tm_cache &tm_cache::instance(pattern_time_type time_type)
+{
+    static tm_cache local_cache(pattern_time_type::local);
+    static tm_cache utc_cache(pattern_time_type::utc);
+    return time_type == pattern_time_type::local ? local_cache : utc_cache;
+}
+
+inline bool tm_cache::try_read_(std::time_t t, std::tm &tm_time) const
+{
+    auto seq = seq_.load(std::memory_order_acquire);
+    if ((seq & 1) != 0 || secs_.load(std::memory_order_relaxed) != static_cast<long long>(t))
+    {
+        return false;
+    }
+
+    word_t words[words_count];
+    for (size_t i = 0; i < words_count; i++)
+    {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != seq)
+    {
+        return false; // raced with the writer
+    }
+    std::memcpy(&tm_time, words, sizeof(std::tm));
+    return true;
+}
+
+inline void tm_cache::try_publish_(std::time_t t, const std::tm &tm_time)
+{
+    // only move forward, so late messages (e.g. from the async queue) don't evict the current second
+    auto seq = seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) != 0 || static_cast<long long>(t) <= secs_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    if (!seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed))
+    {
+        return; // another thread is publishing
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    word_t words[words_count] = {};
+    std::memcpy(words, &tm_time, sizeof(std::tm));
+    for (size_t i = 0; i < words_count; i++)
+    {
+        words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    secs_.store(static_cast<long long>(t), std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+} // namespace details
+} // namespace spdlog
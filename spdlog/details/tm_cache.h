@@ -0,0 +1,51 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// process wide cache of the broken down time of the latest second logged.
+//
+// shared by all the formatters, so os::localtime()/os::gmtime() (and the
+// time zone lock inside the libc) are hit about once per second in the whole
+// process instead of once per second per formatter.
+// readers never block - the cache is a seqlock, a reader that races with the
+// (single) writer just computes the time itself.
+
+#include <spdlog/common.h>
+
+#include <atomic>
+#include <ctime>
+
+namespace spdlog {
+namespace details {
+
+class tm_cache
+{
+public:
+    explicit tm_cache(pattern_time_type time_type);
+    tm_cache(const tm_cache &) = delete;
+    tm_cache &operator=(const tm_cache &) = delete;
+
+    // the broken down time of t. from the cache if t is in the cached second.
+    std::tm get(std::time_t t);
+
+    // the process wide cache of the given time type
+    static tm_cache &instance(pattern_time_type time_type);
+
+private:
+    using word_t = unsigned long long;
+    static const size_t words_count = (sizeof(std::tm) + sizeof(word_t) - 1) / sizeof(word_t);
+
+    bool try_read_(std::time_t t, std::tm &tm_time) const;
+    void try_publish_(std::time_t t, const std::tm &tm_time);
+
+    pattern_time_type time_type_;
+    std::atomic<unsigned> seq_{0}; // odd while being written
+    std::atomic<long long> secs_;
+    std::atomic<word_t> words_[words_count];
+};
+
+} // namespace details
+} // namespace spdlog
+
+#include "tm_cache-inl.h"
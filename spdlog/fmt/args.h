@@ -0,0 +1,13 @@
+//
+// Copyright(c) 2016 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+//
+// include bundled or external copy of fmtlib's dynamic argument lists support
+//
+
+#if !defined(SPDLOG_USE_STD_FORMAT)
+#    include <spdlog/fmt/bundled/args.h>
+#endif
@@ -6,6 +6,8 @@
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/details/log_msg.h>
 
+#include <string>
+
 namespace spdlog {
 
 class formatter
@@ -14,5 +16,12 @@ public:
     virtual ~formatter() = default;
     virtual void format(const details::log_msg &msg, memory_buf_t &dest) = 0;
     virtual std::unique_ptr<formatter> clone() const = 0;
+
+    // formatters with the same non empty key format any message the same way, so sinks with equivalent
+    // formatters can share the formatting (see sink::formatter_key()). empty by default - not shared.
+    virtual std::string key() const
+    {
+        return std::string{};
+    }
 };
 } // namespace spdlog
@@ -5,8 +5,10 @@
 
 #include <spdlog/sinks/sink.h>
 #include <spdlog/details/backtracer.h>
+#include <spdlog/details/formatter_keys.h>
 #include <spdlog/pattern_formatter.h>
 
+#include <algorithm>
 #include <cstdio>
 
 namespace spdlog {
@@ -19,6 +21,7 @@ inline logger::logger(const logger &other)
     , flush_level_(other.flush_level_.load(std::memory_order_relaxed))
     , custom_err_handler_(other.custom_err_handler_)
     , tracer_(other.tracer_)
+    , defer_formatting_(other.defer_formatting_.load(std::memory_order_relaxed))
 {}
 
 inline logger::logger(logger &&other) noexcept : name_(std::move(other.name_)),
@@ -26,7 +29,8 @@ inline logger::logger(logger &&other) noexcept : name_(std::move(other.name_)),
                                                                level_(other.level_.load(std::memory_order_relaxed)),
                                                                flush_level_(other.flush_level_.load(std::memory_order_relaxed)),
                                                                custom_err_handler_(std::move(other.custom_err_handler_)),
-                                                               tracer_(std::move(other.tracer_))
+                                                               tracer_(std::move(other.tracer_)),
+                                                               defer_formatting_(other.defer_formatting_.load(std::memory_order_relaxed))
 
 {}
 
@@ -53,6 +57,12 @@ inline void logger::swap(spdlog::logger &other) noexcept
 
     custom_err_handler_.swap(other.custom_err_handler_);
     std::swap(tracer_, other.tracer_);
+
+    auto other_defer = other.defer_formatting_.load();
+    other.defer_formatting_.store(defer_formatting_.exchange(other_defer));
+
+    // both loggers regroup their sinks
+    details::formatter_keys::bump_generation();
 }
 
 inline void swap(logger &a, logger &b)
@@ -139,8 +149,10 @@ inline const std::vector<sink_ptr> &logger::sinks() const
     return sinks_;
 }
 
+// the sinks are about to change - regroup them by formatter key on the next message
 inline std::vector<sink_ptr> &logger::sinks()
 {
+    details::formatter_keys::bump_generation();
     return sinks_;
 }
 
@@ -173,17 +185,21 @@ inline void logger::log_it_(const spdlog::details::log_msg &log_msg, bool log_en
 
 inline void logger::sink_it_(const details::log_msg &msg)
 {
-    for (auto &sink : sinks_)
+    if (sinks_.size() == 1)
     {
-        if (sink->should_log(msg.level))
+        if (sinks_[0]->should_log(msg.level))
         {
             try
             {
-                sink->log(msg);
+                sinks_[0]->log(msg);
             }
             SPDLOG_LOGGER_CATCH(msg.source)
         }
     }
+    else
+    {
+        log_to_sinks_(&msg, 1);
+    }
 
     if (should_flush_(msg))
     {
@@ -191,6 +207,155 @@ inline void logger::sink_it_(const details::log_msg &msg)
     }
 }
 
+// not deferred by the base logger - format right away
+inline void logger::sink_deferred_(const details::log_msg &msg)
+{
+    details::deferred_formatter formatter;
+    details::pooled_buffer buf_buf;
+    memory_buf_t &buf = buf_buf.get();
+    formatter.format(msg.captured_args, buf);
+    details::log_msg formatted_msg = msg;
+    formatted_msg.payload = string_view_t(buf.data(), buf.size());
+    sink_it_(formatted_msg);
+}
+
+// log the messages to the sinks, in the order they were added
+inline void logger::log_to_sinks_(const details::log_msg *msgs, size_t count)
+{
+    std::uint32_t shared = shared_sinks_();
+    if (shared != 0)
+    {
+        log_to_sharing_sinks_(msgs, count, shared);
+        return;
+    }
+
+    const auto &location = count == 1 ? msgs[0].source : source_loc{};
+    for (auto &sink : sinks_)
+    {
+        if (count == 1)
+        {
+            if (sink->should_log(msgs[0].level))
+            {
+                try
+                {
+                    sink->log(msgs[0]);
+                }
+                SPDLOG_LOGGER_CATCH(location)
+            }
+            continue;
+        }
+        log_filtered_(*sink, msgs, count);
+    }
+}
+
+// as log_to_sinks_(..), but the sinks which log all the messages and share their formatter key with
+// another sink (bit set in shared) get them formatted once, through sink::log_formatted(..)
+inline void logger::log_to_sharing_sinks_(const details::log_msg *msgs, size_t count, std::uint32_t shared)
+{
+    const auto &location = count == 1 ? msgs[0].source : source_loc{};
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
+    size_t formatted_key = 0; // the formatter key of the content of formatted
+    for (size_t i = 0; i < sinks_.size(); i++)
+    {
+        auto &sink = sinks_[i];
+        bool logs_all = true;
+        for (size_t m = 0; m < count && logs_all; m++)
+        {
+            logs_all = sink->should_log(msgs[m].level);
+        }
+        if (!logs_all)
+        {
+            log_filtered_(*sink, msgs, count);
+            continue;
+        }
+
+        size_t key = (shared >> (std::min)(i, size_t{31}) & 1) != 0 ? sink->formatter_key() : 0;
+        try
+        {
+            if (key != 0)
+            {
+                // sinks of another key in between - format again
+                if (formatted_key != key)
+                {
+                    formatted.clear();
+                    formatted_key = key;
+                }
+                sink->log_formatted(msgs, count, formatted);
+            }
+            else if (count == 1)
+            {
+                sink->log(msgs[0]);
+            }
+            else
+            {
+                sink->log_batch(msgs, count);
+            }
+        }
+        SPDLOG_LOGGER_CATCH(location)
+    }
+}
+
+// log the messages the sink does not filter out - at once if it logs them all
+inline void logger::log_filtered_(sinks::sink &sink, const details::log_msg *msgs, size_t count)
+{
+    size_t logged = 0;
+    for (size_t m = 0; m < count; m++)
+    {
+        logged += sink.should_log(msgs[m].level) ? size_t{1} : size_t{0};
+    }
+    if (logged == count)
+    {
+        try
+        {
+            sink.log_batch(msgs, count);
+        }
+        SPDLOG_LOGGER_CATCH(source_loc{})
+        return;
+    }
+    for (size_t m = 0; logged > 0 && m < count; m++)
+    {
+        if (sink.should_log(msgs[m].level))
+        {
+            try
+            {
+                sink.log(msgs[m]);
+            }
+            SPDLOG_LOGGER_CATCH(msgs[m].source)
+        }
+    }
+}
+
+// bit i set if sinks_[i] shares its formatter key with another sink of the logger (the last bit: any
+// sink from there on). regrouped only when the generation of the keys changed, so no scan per message.
+// a hint: a stale mask makes the sinks format a message more (or less) often, never differently.
+inline std::uint32_t logger::shared_sinks_()
+{
+    std::uint32_t generation = details::formatter_keys::generation();
+    std::uint64_t cached = shared_sinks_cache_.load(std::memory_order_relaxed);
+    if (static_cast<std::uint32_t>(cached >> 32) == generation)
+    {
+        return static_cast<std::uint32_t>(cached);
+    }
+
+    std::uint32_t shared = 0;
+    const size_t sinks_count = sinks_.size();
+    for (size_t i = 0; i < sinks_count; i++)
+    {
+        size_t key = sinks_[i]->formatter_key();
+        for (size_t j = i + 1; key != 0 && j < sinks_count; j++)
+        {
+            if (sinks_[j]->formatter_key() == key)
+            {
+                shared |= std::uint32_t{1} << (std::min)(i, size_t{31});
+                shared |= std::uint32_t{1} << (std::min)(j, size_t{31});
+            }
+        }
+    }
+    shared_sinks_cache_.store(static_cast<std::uint64_t>(generation) << 32 | shared, std::memory_order_relaxed);
+    return shared;
+}
+
 inline void logger::flush_()
 {
     for (auto &sink : sinks_)
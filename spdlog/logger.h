@@ -17,7 +17,10 @@
 #include <spdlog/common.h>
 #include <spdlog/details/log_msg.h>
 #include <spdlog/details/backtracer.h>
+#include <spdlog/details/buffer_pool.h>
+#include <spdlog/details/deferred_args.h>
 
+#include <cstdint>
 #include <vector>
 
 #define SPDLOG_LOGGER_CATCH(location)                                                                                                      \
@@ -258,6 +261,9 @@ protected:
     spdlog::level_t flush_level_{level::off};
     err_handler custom_err_handler_{nullptr};
     details::backtracer tracer_;
+    std::atomic<bool> defer_formatting_{false};
+    // the generation (high half) and the mask (low half) last returned by shared_sinks_(). not copied.
+    std::atomic<std::uint64_t> shared_sinks_cache_{0};
 
     // common implementation for after templated public api has been resolved
     template<typename... Args>
@@ -271,7 +277,17 @@ protected:
         }
         try
         {
-            memory_buf_t buf;
+            details::pooled_buffer pooled_buf;
+            memory_buf_t &buf = pooled_buf.get();
+            // capture the arguments instead (if possible), to be formatted by sink_deferred_(..).
+            // the backtrace needs the formatted text right away.
+            if (!traceback_enabled && defer_formatting_.load(std::memory_order_relaxed) && details::encode_deferred(buf, fmt, args...))
+            {
+                details::log_msg log_msg(loc, name_, lvl, string_view_t{});
+                log_msg.captured_args = string_view_t(buf.data(), buf.size());
+                sink_deferred_(log_msg);
+                return;
+            }
 #ifdef SPDLOG_USE_STD_FORMAT
             fmt_lib::vformat_to(std::back_inserter(buf), fmt, fmt_lib::make_format_args(std::forward<Args>(args)...));
 #else
@@ -289,7 +305,13 @@ protected:
     // and save backtrace (if backtrace is enabled).
     void log_it_(const details::log_msg &log_msg, bool log_enabled, bool traceback_enabled);
     virtual void sink_it_(const details::log_msg &msg);
+    // msg.payload is empty - the message is to be formatted from msg.captured_args.
+    virtual void sink_deferred_(const details::log_msg &msg);
     virtual void flush_();
+    void log_to_sinks_(const details::log_msg *msgs, size_t count);
+    void log_to_sharing_sinks_(const details::log_msg *msgs, size_t count, std::uint32_t shared);
+    void log_filtered_(sinks::sink &sink, const details::log_msg *msgs, size_t count);
+    std::uint32_t shared_sinks_();
     void dump_backtrace_();
     bool should_flush_(const details::log_msg &msg);
 
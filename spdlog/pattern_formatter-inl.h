@@ -6,6 +6,7 @@
 #include <spdlog/details/fmt_helper.h>
 #include <spdlog/details/log_msg.h>
 #include <spdlog/details/os.h>
+#include <spdlog/details/tm_cache.h>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/formatter.h>
 
@@ -722,6 +723,36 @@ private:
     std::string str_;
 };
 
+// a run of date/time flags and user chars that only changes once per second (e.g. "[%Y-%m-%d %H:%M:%S.").
+// formatted once and cached for the next second, like full_formatter does.
+class datetime_run_formatter final : public flag_formatter
+{
+public:
+    explicit datetime_run_formatter(std::vector<std::unique_ptr<flag_formatter>> formatters)
+        : formatters_(std::move(formatters))
+    {}
+
+    void format(const details::log_msg &msg, const std::tm &tm_time, memory_buf_t &dest) override
+    {
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.time.time_since_epoch());
+        if (cache_timestamp_ != secs || cached_datetime_.size() == 0)
+        {
+            cached_datetime_.clear();
+            for (auto &f : formatters_)
+            {
+                f->format(msg, tm_time, cached_datetime_);
+            }
+            cache_timestamp_ = secs;
+        }
+        dest.append(cached_datetime_.begin(), cached_datetime_.end());
+    }
+
+private:
+    std::vector<std::unique_ptr<flag_formatter>> formatters_;
+    std::chrono::seconds cache_timestamp_{0};
+    memory_buf_t cached_datetime_;
+};
+
 // mark the color range. expect it to be in the form of "%^colored text%$"
 class color_start_formatter final : public flag_formatter
 {
@@ -1072,6 +1103,34 @@ inline void pattern_formatter::format(const details::log_msg &msg, memory_buf_t
     details::fmt_helper::append_string_view(eol_, dest);
 }
 
+// the time type, eol and pattern. empty (not shared) with custom flags or the elapsed time flags,
+// which depend on the previous messages the formatter saw.
+inline std::string pattern_formatter::key() const
+{
+    if (!custom_handlers_.empty())
+    {
+        return std::string{};
+    }
+    for (auto it = pattern_.begin(); it != pattern_.end(); ++it)
+    {
+        if (*it != '%')
+        {
+            continue;
+        }
+        handle_padspec_(++it, pattern_.end());
+        if (it == pattern_.end())
+        {
+            break;
+        }
+        if (*it == 'u' || *it == 'i' || *it == 'o' || *it == 'O')
+        {
+            return std::string{};
+        }
+    }
+    return fmt_lib::format(SPDLOG_FMT_STRING("{}:{}:{}:{}{}"), static_cast<int>(pattern_time_type_), need_localtime_ ? 1 : 0,
+        eol_.size(), eol_, pattern_);
+}
+
 inline void pattern_formatter::set_pattern(std::string pattern)
 {
     pattern_ = std::move(pattern);
@@ -1086,11 +1145,7 @@ inline void pattern_formatter::need_localtime(bool need)
 
 inline std::tm pattern_formatter::get_time_(const details::log_msg &msg)
 {
-    if (pattern_time_type_ == pattern_time_type::local)
-    {
-        return details::os::localtime(log_clock::to_time_t(msg.time));
-    }
-    return details::os::gmtime(log_clock::to_time_t(msg.time));
+    return details::tm_cache::instance(pattern_time_type_).get(log_clock::to_time_t(msg.time));
 }
 
 template<typename Padder>
@@ -1383,6 +1438,7 @@ inline void pattern_formatter::compile_pattern_(const std::string &pattern)
 {
     auto end = pattern.end();
     std::unique_ptr<details::aggregate_formatter> user_chars;
+    std::vector<bool> per_second; // whether each formatter only depends on the seconds of the message time
     formatters_.clear();
     for (auto it = pattern.begin(); it != end; ++it)
     {
@@ -1391,6 +1447,7 @@ inline void pattern_formatter::compile_pattern_(const std::string &pattern)
             if (user_chars) // append user chars found so far
             {
                 formatters_.push_back(std::move(user_chars));
+                per_second.push_back(true);
             }
 
             auto padding = handle_padspec_(++it, end);
@@ -1405,6 +1462,8 @@ inline void pattern_formatter::compile_pattern_(const std::string &pattern)
                 {
                     handle_flag_<details::null_scoped_padder>(*it, padding);
                 }
+                bool is_datetime = is_datetime_flag_(*it) && custom_handlers_.find(*it) == custom_handlers_.end();
+                per_second.resize(formatters_.size(), is_datetime);
             }
             else
             {
@@ -1423,6 +1482,74 @@ inline void pattern_formatter::compile_pattern_(const std::string &pattern)
     if (user_chars) // append raw chars found so far
     {
         formatters_.push_back(std::move(user_chars));
+        per_second.push_back(true);
+    }
+    fuse_datetime_runs_(per_second);
+}
+
+inline bool pattern_formatter::is_datetime_flag_(char flag)
+{
+    // the flags formatted from the std::tm only
+    switch (flag)
+    {
+    case 'a':
+    case 'A':
+    case 'b':
+    case 'h':
+    case 'B':
+    case 'c':
+    case 'C':
+    case 'Y':
+    case 'D':
+    case 'x':
+    case 'm':
+    case 'd':
+    case 'H':
+    case 'I':
+    case 'M':
+    case 'S':
+    case 'p':
+    case 'r':
+    case 'R':
+    case 'T':
+    case 'X':
+    case 'z':
+        return true;
+    default:
+        return false;
     }
 }
+
+// collapse each run of formatters which only depend on the seconds of the message time
+// into one datetime_run_formatter, so e.g. "[%Y-%m-%d %H:%M:%S.%e]" is formatted once per second
+// except for the millis.
+inline void pattern_formatter::fuse_datetime_runs_(const std::vector<bool> &per_second)
+{
+    std::vector<std::unique_ptr<details::flag_formatter>> fused;
+    size_t i = 0;
+    while (i < formatters_.size())
+    {
+        size_t run_end = i;
+        while (run_end < formatters_.size() && per_second[run_end])
+        {
+            ++run_end;
+        }
+
+        if (run_end - i < 2) // nothing to gain
+        {
+            fused.push_back(std::move(formatters_[i]));
+            ++i;
+            continue;
+        }
+
+        std::vector<std::unique_ptr<details::flag_formatter>> run;
+        for (; i < run_end; ++i)
+        {
+            run.push_back(std::move(formatters_[i]));
+        }
+        fused.push_back(details::make_unique<details::datetime_run_formatter>(std::move(run)));
+    }
+    formatters_ = std::move(fused);
+}
+
 } // namespace spdlog
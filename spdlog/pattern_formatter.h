@@ -90,6 +90,7 @@ public:
 
     std::unique_ptr<formatter> clone() const override;
     void format(const details::log_msg &msg, memory_buf_t &dest) override;
+    std::string key() const override;
 
     template<typename T, typename... Args>
     pattern_formatter &add_flag(char flag, Args &&... args)
@@ -120,6 +121,8 @@ private:
     static details::padding_info handle_padspec_(std::string::const_iterator &it, std::string::const_iterator end);
 
     void compile_pattern_(const std::string &pattern);
+    static bool is_datetime_flag_(char flag);
+    void fuse_datetime_runs_(const std::vector<bool> &per_second);
 };
 } // namespace spdlog
 
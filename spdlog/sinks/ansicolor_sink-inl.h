@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <spdlog/details/buffer_pool.h>
 #include <spdlog/pattern_formatter.h>
 #include <spdlog/details/os.h>
 
@@ -41,7 +42,8 @@ inline void ansicolor_sink<ConsoleMutex>::log(const details::log_msg &msg)
     std::lock_guard<mutex_t> lock(mutex_);
     msg.color_range_start = 0;
     msg.color_range_end = 0;
-    memory_buf_t formatted;
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
     formatter_->format(msg, formatted);
     if (should_do_colors_ && msg.color_range_end > msg.color_range_start)
     {
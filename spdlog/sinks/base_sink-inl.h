@@ -4,19 +4,32 @@
 #pragma once
 
 #include <spdlog/common.h>
+#include <spdlog/details/formatter_keys.h>
 #include <spdlog/pattern_formatter.h>
 
 #include <memory>
+#include <mutex>
+#include <string>
 
 template<typename Mutex>
 inline spdlog::sinks::base_sink<Mutex>::base_sink()
     : formatter_{details::make_unique<spdlog::pattern_formatter>()}
-{}
+{
+    update_formatter_key_();
+}
 
 template<typename Mutex>
 inline spdlog::sinks::base_sink<Mutex>::base_sink(std::unique_ptr<spdlog::formatter> formatter)
     : formatter_{std::move(formatter)}
-{}
+{
+    update_formatter_key_();
+}
+
+template<typename Mutex>
+inline spdlog::sinks::base_sink<Mutex>::~base_sink()
+{
+    details::formatter_keys::release(formatter_key_.load(std::memory_order_relaxed));
+}
 
 template<typename Mutex>
 void inline spdlog::sinks::base_sink<Mutex>::log(const details::log_msg &msg)
@@ -25,6 +38,41 @@ void inline spdlog::sinks::base_sink<Mutex>::log(const details::log_msg &msg)
     sink_it_(msg);
 }
 
+template<typename Mutex>
+void inline spdlog::sinks::base_sink<Mutex>::log_batch(const details::log_msg *msgs, size_t count)
+{
+    std::lock_guard<Mutex> lock(mutex_);
+    sink_batch_(msgs, count);
+}
+
+template<typename Mutex>
+size_t inline spdlog::sinks::base_sink<Mutex>::formatter_key() const
+{
+    return writes_formatted_() ? formatter_key_.load(std::memory_order_relaxed) : 0;
+}
+
+template<typename Mutex>
+void inline spdlog::sinks::base_sink<Mutex>::log_formatted(const details::log_msg *msgs, size_t count, memory_buf_t &formatted)
+{
+    std::lock_guard<Mutex> lock(mutex_);
+    if (formatted.size() == 0)
+    {
+        try
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                formatter_->format(msgs[i], formatted);
+            }
+        }
+        catch (...)
+        {
+            formatted.clear(); // not to be reused by the next sinks
+            throw;
+        }
+    }
+    sink_formatted_(msgs, count, formatted);
+}
+
 template<typename Mutex>
 void inline spdlog::sinks::base_sink<Mutex>::flush()
 {
@@ -37,6 +85,7 @@ void inline spdlog::sinks::base_sink<Mutex>::set_pattern(const std::string &patt
 {
     std::lock_guard<Mutex> lock(mutex_);
     set_pattern_(pattern);
+    update_formatter_key_();
 }
 
 template<typename Mutex>
@@ -44,6 +93,7 @@ void inline spdlog::sinks::base_sink<Mutex>::set_formatter(std::unique_ptr<spdlo
 {
     std::lock_guard<Mutex> lock(mutex_);
     set_formatter_(std::move(sink_formatter));
+    update_formatter_key_();
 }
 
 template<typename Mutex>
@@ -57,3 +107,36 @@ void inline spdlog::sinks::base_sink<Mutex>::set_formatter_(std::unique_ptr<spdl
 {
     formatter_ = std::move(sink_formatter);
 }
+
+template<typename Mutex>
+void inline spdlog::sinks::base_sink<Mutex>::sink_batch_(const details::log_msg *msgs, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        sink_it_(msgs[i]);
+    }
+}
+
+template<typename Mutex>
+bool inline spdlog::sinks::base_sink<Mutex>::writes_formatted_() const
+{
+    return false;
+}
+
+template<typename Mutex>
+void inline spdlog::sinks::base_sink<Mutex>::sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &)
+{
+    sink_batch_(msgs, count);
+}
+
+template<typename Mutex>
+void inline spdlog::sinks::base_sink<Mutex>::update_formatter_key_()
+{
+    size_t key = formatter_ ? details::formatter_keys::acquire(formatter_->key()) : 0;
+    size_t old_key = formatter_key_.exchange(key, std::memory_order_relaxed);
+    details::formatter_keys::release(old_key);
+    if (key != old_key)
+    {
+        details::formatter_keys::bump_generation();
+    }
+}
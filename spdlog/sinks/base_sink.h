@@ -10,9 +10,12 @@
 //
 
 #include <spdlog/common.h>
+#include <spdlog/details/buffer_pool.h>
 #include <spdlog/details/log_msg.h>
 #include <spdlog/sinks/sink.h>
 
+#include <atomic>
+
 namespace spdlog {
 namespace sinks {
 template<typename Mutex>
@@ -21,7 +24,7 @@ class base_sink : public sink
 public:
     base_sink();
     explicit base_sink(std::unique_ptr<spdlog::formatter> formatter);
-    ~base_sink() override = default;
+    ~base_sink() override;
 
     base_sink(const base_sink &) = delete;
     base_sink(base_sink &&) = delete;
@@ -30,6 +33,9 @@ public:
     base_sink &operator=(base_sink &&) = delete;
 
     void log(const details::log_msg &msg) final;
+    void log_batch(const details::log_msg *msgs, size_t count) final;
+    size_t formatter_key() const final;
+    void log_formatted(const details::log_msg *msgs, size_t count, memory_buf_t &formatted) final;
     void flush() final;
     void set_pattern(const std::string &pattern) final;
     void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) final;
@@ -40,9 +46,23 @@ protected:
     Mutex mutex_;
 
     virtual void sink_it_(const details::log_msg &msg) = 0;
+    // called under the sink's lock. calls sink_it_(..) for each message by default.
+    virtual void sink_batch_(const details::log_msg *msgs, size_t count);
+    // sinks which write the output of formatter_ as is can take it preformatted - return true,
+    // and override sink_formatted_(..).
+    virtual bool writes_formatted_() const;
+    // called under the sink's lock with the messages formatted by formatter_ (or an equivalent formatter).
+    // calls sink_batch_(..) by default.
+    virtual void sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted);
     virtual void flush_() = 0;
     virtual void set_pattern_(const std::string &pattern);
     virtual void set_formatter_(std::unique_ptr<spdlog::formatter> sink_formatter);
+
+private:
+    void update_formatter_key_();
+
+    // id of formatter_->key() held in details::formatter_keys, 0 if empty. read without the lock by formatter_key().
+    std::atomic<size_t> formatter_key_{0};
 };
 } // namespace sinks
 } // namespace spdlog
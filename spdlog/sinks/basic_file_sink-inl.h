@@ -9,29 +9,55 @@
 namespace spdlog {
 namespace sinks {
 
-template<typename Mutex>
-inline basic_file_sink<Mutex>::basic_file_sink(const filename_t &filename, bool truncate, const file_event_handlers &event_handlers)
+template<typename Mutex, typename FileHelper>
+inline basic_file_sink<Mutex, FileHelper>::basic_file_sink(const filename_t &filename, bool truncate, const file_event_handlers &event_handlers)
     : file_helper_{event_handlers}
 {
     file_helper_.open(filename, truncate);
 }
 
-template<typename Mutex>
-inline const filename_t &basic_file_sink<Mutex>::filename() const
+template<typename Mutex, typename FileHelper>
+inline const filename_t &basic_file_sink<Mutex, FileHelper>::filename() const
 {
     return file_helper_.filename();
 }
 
-template<typename Mutex>
-inline void basic_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
+template<typename Mutex, typename FileHelper>
+inline void basic_file_sink<Mutex, FileHelper>::sink_it_(const details::log_msg &msg)
 {
-    memory_buf_t formatted;
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
     base_sink<Mutex>::formatter_->format(msg, formatted);
     file_helper_.write(formatted);
 }
 
-template<typename Mutex>
-inline void basic_file_sink<Mutex>::flush_()
+// format the whole batch into one buffer and write it at once
+template<typename Mutex, typename FileHelper>
+inline void basic_file_sink<Mutex, FileHelper>::sink_batch_(const details::log_msg *msgs, size_t count)
+{
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
+    for (size_t i = 0; i < count; i++)
+    {
+        base_sink<Mutex>::formatter_->format(msgs[i], formatted);
+    }
+    file_helper_.write(formatted);
+}
+
+template<typename Mutex, typename FileHelper>
+inline bool basic_file_sink<Mutex, FileHelper>::writes_formatted_() const
+{
+    return true;
+}
+
+template<typename Mutex, typename FileHelper>
+inline void basic_file_sink<Mutex, FileHelper>::sink_formatted_(const details::log_msg *, size_t, const memory_buf_t &formatted)
+{
+    file_helper_.write(formatted);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void basic_file_sink<Mutex, FileHelper>::flush_()
 {
     file_helper_.flush();
 }
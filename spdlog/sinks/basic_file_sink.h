@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <spdlog/details/fd_file_helper.h>
 #include <spdlog/details/file_helper.h>
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/sinks/base_sink.h>
@@ -16,7 +17,7 @@ namespace sinks {
 /*
  * Trivial file sink with single file as target
  */
-template<typename Mutex>
+template<typename Mutex, typename FileHelper = details::file_helper>
 class basic_file_sink final : public base_sink<Mutex>
 {
 public:
@@ -25,10 +26,13 @@ public:
 
 protected:
     void sink_it_(const details::log_msg &msg) override;
+    void sink_batch_(const details::log_msg *msgs, size_t count) override;
+    bool writes_formatted_() const override;
+    void sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted) override;
     void flush_() override;
 
 private:
-    details::file_helper file_helper_;
+    FileHelper file_helper_;
 };
 
 using basic_file_sink_mt = basic_file_sink<std::mutex>;
@@ -0,0 +1,59 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+namespace spdlog {
+namespace sinks {
+
+template<typename Mutex>
+inline binary_file_sink<Mutex>::binary_file_sink(const filename_t &filename, bool truncate, const file_event_handlers &event_handlers)
+    : file_helper_{event_handlers}
+{
+    file_helper_.open(filename, truncate);
+    memory_buf_t header;
+    encoder_.begin(header);
+    file_helper_.write(header);
+}
+
+template<typename Mutex>
+inline const filename_t &binary_file_sink<Mutex>::filename() const
+{
+    return file_helper_.filename();
+}
+
+template<typename Mutex>
+inline bool binary_file_sink<Mutex>::uses_payload() const
+{
+    return false;
+}
+
+template<typename Mutex>
+inline void binary_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
+{
+    memory_buf_t encoded;
+    encoder_.encode(msg, encoded);
+    file_helper_.write(encoded);
+}
+
+template<typename Mutex>
+inline void binary_file_sink<Mutex>::sink_batch_(const details::log_msg *msgs, size_t count)
+{
+    memory_buf_t encoded;
+    for (size_t i = 0; i < count; i++)
+    {
+        encoder_.encode(msgs[i], encoded);
+    }
+    file_helper_.write(encoded);
+}
+
+template<typename Mutex>
+inline void binary_file_sink<Mutex>::flush_()
+{
+    file_helper_.flush();
+}
+
+} // namespace sinks
+} // namespace spdlog
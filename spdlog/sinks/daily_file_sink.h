@@ -4,7 +4,10 @@
 #pragma once
 
 #include <spdlog/common.h>
+#include <spdlog/details/fd_file_helper.h>
+#include <spdlog/details/file_compressor.h>
 #include <spdlog/details/file_helper.h>
+#include <spdlog/details/file_housekeeper.h>
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/fmt/chrono.h>
@@ -16,6 +19,7 @@
 #include <chrono>
 #include <cstdio>
 #include <ctime>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -107,7 +111,7 @@ private:
  * If truncate != false , the created file will be truncated.
  * If max_files > 0, retain only the last max_files and delete previous.
  */
-template<typename Mutex, typename FileNameCalc = daily_filename_calculator>
+template<typename Mutex, typename FileNameCalc = daily_filename_calculator, typename FileHelper = details::file_helper>
 class daily_file_sink final : public base_sink<Mutex>
 {
 public:
@@ -117,7 +121,8 @@ public:
         : base_filename_(std::move(base_filename))
         , rotation_h_(rotation_hour)
         , rotation_m_(rotation_minute)
-        , file_helper_{event_handlers}
+        , event_handlers_(event_handlers)
+        , file_helper_(details::make_unique<FileHelper>(event_handlers))
         , truncate_(truncate)
         , max_files_(max_files)
         , filenames_q_()
@@ -129,7 +134,7 @@ public:
 
         auto now = log_clock::now();
         auto filename = FileNameCalc::calc_filename(base_filename_, now_tm(now));
-        file_helper_.open(filename, truncate_);
+        file_helper_->open(filename, truncate_);
         rotation_tp_ = next_rotation_tp_();
 
         if (max_files_ > 0)
@@ -141,7 +146,31 @@ public:
     filename_t filename()
     {
         std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
-        return file_helper_.filename();
+        return file_helper_->filename();
+    }
+
+    // leave closing the rotated files and deleting the old ones to the housekeeper's thread,
+    // so a rotation costs the logging thread only the opening of the new file.
+    // nullptr (the default) does it all in the logging thread, unless the files are compressed.
+    void set_housekeeper(std::shared_ptr<details::file_housekeeper> housekeeper)
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+        housekeeper_ = housekeeper || !compressor_.enabled() ? std::move(housekeeper) : details::file_housekeeper::shared();
+    }
+
+    // compress each rotated file (e.g. log_2024-01-01.txt -> log_2024-01-01.txt.gz) on the housekeeper's thread -
+    // details::file_housekeeper::shared() if none was set.
+    // level - 1 (fastest) to 9 (smallest), or -1 for the default of the library.
+    // the compressed files count as the files they were in max_files.
+    void set_compression(file_compression compression, int level = -1)
+    {
+        details::file_compressor compressor(compression, level);
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+        compressor_ = compressor;
+        if (compressor_.enabled() && !housekeeper_)
+        {
+            housekeeper_ = details::file_housekeeper::shared();
+        }
     }
 
 protected:
@@ -149,40 +178,59 @@ protected:
     {
         auto time = msg.time;
         bool should_rotate = time >= rotation_tp_;
+        std::shared_ptr<FileHelper> rotated_file;
         if (should_rotate)
         {
             auto filename = FileNameCalc::calc_filename(base_filename_, now_tm(time));
-            file_helper_.open(filename, truncate_);
+            rotated_file = swap_file_(filename);
             rotation_tp_ = next_rotation_tp_();
         }
-        memory_buf_t formatted;
+        details::pooled_buffer formatted_buf;
+        memory_buf_t &formatted = formatted_buf.get();
         base_sink<Mutex>::formatter_->format(msg, formatted);
-        file_helper_.write(formatted);
+        file_helper_->write(formatted);
 
         // Do the cleaning only at the end because it might throw on failure.
-        if (should_rotate && max_files_ > 0)
+        if (should_rotate)
         {
-            delete_old_();
+            clean_up_(std::move(rotated_file));
         }
     }
 
+    bool writes_formatted_() const override
+    {
+        return true;
+    }
+
+    // messages which need the file to be rotated first go through sink_it_(..)
+    void sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted) override
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (msgs[i].time >= rotation_tp_)
+            {
+                base_sink<Mutex>::sink_batch_(msgs, count);
+                return;
+            }
+        }
+        file_helper_->write(formatted);
+    }
+
     void flush_() override
     {
-        file_helper_.flush();
+        file_helper_->flush();
     }
 
 private:
     void init_filenames_q_()
     {
-        using details::os::path_exists;
-
         filenames_q_ = details::circular_q<filename_t>(static_cast<size_t>(max_files_));
         std::vector<filename_t> filenames;
         auto now = log_clock::now();
         while (filenames.size() < max_files_)
         {
             auto filename = FileNameCalc::calc_filename(base_filename_, now_tm(now));
-            if (!path_exists(filename))
+            if (!details::file_compressor::exists(filename))
             {
                 break;
             }
@@ -216,36 +264,79 @@ private:
         return {rotation_time + std::chrono::hours(24)};
     }
 
-    // Delete the file N rotations ago.
-    // Throw spdlog_ex on failure to delete the old file.
-    void delete_old_()
+    // Open the given file and return the previous one (still open), or nullptr if it is the same file.
+    std::shared_ptr<FileHelper> swap_file_(const filename_t &filename)
     {
-        using details::os::filename_to_str;
-        using details::os::remove_if_exists;
+        if (filename == file_helper_->filename())
+        {
+            file_helper_->open(filename, truncate_);
+            return nullptr;
+        }
+        auto new_file = details::make_unique<FileHelper>(event_handlers_);
+        new_file->open(filename, truncate_);
+        std::shared_ptr<FileHelper> old_file(std::move(file_helper_));
+        file_helper_ = std::move(new_file);
+        return old_file;
+    }
 
-        filename_t current_file = file_helper_.filename();
-        if (filenames_q_.full())
+    // Delete the file N rotations ago, and close (and compress) the rotated file - on the housekeeper's thread if any.
+    // Throw spdlog_ex on failure to delete the old file.
+    void clean_up_(std::shared_ptr<FileHelper> rotated_file)
+    {
+        filename_t old_filename = max_files_ > 0 ? pop_old_filename_() : filename_t{};
+        if (!rotated_file && old_filename.empty())
         {
-            auto old_filename = std::move(filenames_q_.front());
-            filenames_q_.pop_front();
-            bool ok = remove_if_exists(old_filename) == 0;
-            if (!ok)
+            return;
+        }
+        details::file_compressor compressor = compressor_;
+        auto task = [rotated_file, old_filename, compressor] {
+            using details::os::filename_to_str;
+
+            if (!old_filename.empty() && details::file_compressor::remove_if_exists(old_filename) != 0)
             {
-                filenames_q_.push_back(std::move(current_file));
                 throw_spdlog_ex("Failed removing daily file " + filename_to_str(old_filename), errno);
             }
+            if (rotated_file)
+            {
+                rotated_file->close();
+                compressor.compress(rotated_file->filename());
+            }
+        };
+        if (housekeeper_)
+        {
+            housekeeper_->post(task);
+        }
+        else
+        {
+            task();
+        }
+    }
+
+    // Push the current file to the queue, and return the file N rotations ago to delete (empty if none).
+    filename_t pop_old_filename_()
+    {
+        filename_t current_file = file_helper_->filename();
+        filename_t old_filename;
+        if (filenames_q_.full())
+        {
+            old_filename = std::move(filenames_q_.front());
+            filenames_q_.pop_front();
         }
         filenames_q_.push_back(std::move(current_file));
+        return old_filename;
     }
 
     filename_t base_filename_;
     int rotation_h_;
     int rotation_m_;
     log_clock::time_point rotation_tp_;
-    details::file_helper file_helper_;
+    file_event_handlers event_handlers_;
+    std::unique_ptr<FileHelper> file_helper_; // a pointer, so a rotated file can be handed to the housekeeper
     bool truncate_;
     uint16_t max_files_;
     details::circular_q<filename_t> filenames_q_;
+    std::shared_ptr<details::file_housekeeper> housekeeper_;
+    details::file_compressor compressor_;
 };
 
 using daily_file_sink_mt = daily_file_sink<std::mutex>;
@@ -0,0 +1,353 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/os.h>
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iterator>
+#include <tuple>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace spdlog {
+namespace sinks {
+
+template<typename Mutex, typename FileHelper>
+inline hybrid_rotating_file_sink<Mutex, FileHelper>::hybrid_rotating_file_sink(filename_t base_filename, std::size_t max_size,
+    rotation_period period, std::size_t max_files, std::size_t max_total_size, std::chrono::seconds max_age,
+    const file_event_handlers &event_handlers)
+    : base_filename_(std::move(base_filename))
+    , max_size_(max_size)
+    , period_(period)
+    , max_files_(max_files)
+    , max_total_size_(max_total_size)
+    , max_age_(max_age)
+    , event_handlers_(event_handlers)
+    , file_helper_(details::make_unique<FileHelper>(event_handlers))
+{
+    if (max_size == 0)
+    {
+        throw_spdlog_ex("hybrid rotating sink constructor: max_size arg cannot be zero");
+    }
+
+    period_tm_ = now_tm_(log_clock::now());
+    scan_files_(period_tm_);
+    file_helper_->open(calc_filename(base_filename_, period_, period_tm_, index_));
+    current_size_ = file_helper_->size(); // expensive. called only once
+    rotation_tp_ = next_rotation_tp_();
+    remove_files_(pop_old_files_());
+}
+
+template<typename Mutex, typename FileHelper>
+inline filename_t hybrid_rotating_file_sink<Mutex, FileHelper>::calc_filename(
+    const filename_t &filename, rotation_period period, const std::tm &tm, std::size_t index)
+{
+    return make_filename_(filename, period_stamp_(period, tm), index);
+}
+
+template<typename Mutex, typename FileHelper>
+inline filename_t hybrid_rotating_file_sink<Mutex, FileHelper>::filename()
+{
+    std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+    return file_helper_->filename();
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::set_housekeeper(std::shared_ptr<details::file_housekeeper> housekeeper)
+{
+    std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+    housekeeper_ = std::move(housekeeper);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::sink_it_(const details::log_msg &msg)
+{
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
+    base_sink<Mutex>::formatter_->format(msg, formatted);
+    write_(formatted, msg.time);
+}
+
+template<typename Mutex, typename FileHelper>
+inline bool hybrid_rotating_file_sink<Mutex, FileHelper>::writes_formatted_() const
+{
+    return true;
+}
+
+// a batch that needs the file to be rolled in its middle goes through sink_it_(..), message by message
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::sink_formatted_(
+    const details::log_msg *msgs, size_t count, const memory_buf_t &formatted)
+{
+    if (count > 1)
+    {
+        bool fits = current_size_ + formatted.size() <= max_size_;
+        for (size_t i = 0; fits && i < count; i++)
+        {
+            fits = msgs[i].time < rotation_tp_;
+        }
+        if (!fits)
+        {
+            base_sink<Mutex>::sink_batch_(msgs, count);
+            return;
+        }
+    }
+    write_(formatted, msgs[0].time);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::flush_()
+{
+    file_helper_->flush();
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::write_(const memory_buf_t &formatted, log_clock::time_point time)
+{
+    // the only per message cost of the two triggers
+    if (time >= rotation_tp_ || current_size_ + formatted.size() > max_size_)
+    {
+        roll_(time, formatted.size());
+    }
+    file_helper_->write(formatted);
+    current_size_ += formatted.size();
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::roll_(log_clock::time_point time, std::size_t msg_size)
+{
+    if (time >= rotation_tp_)
+    {
+        rotate_(now_tm_(time), 0);
+        rotation_tp_ = next_rotation_tp_();
+        return;
+    }
+
+    // same as in rotating_file_sink::write_(..) - rotate only if the real size doesn't fit either,
+    // and is > 0 to better deal with full disk.
+    file_helper_->flush();
+    current_size_ = file_helper_->size();
+    if (current_size_ + msg_size > max_size_ && current_size_ > 0)
+    {
+        rotate_(period_tm_, index_ + 1);
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::rotate_(const std::tm &period_tm, std::size_t index)
+{
+    filename_t filename = calc_filename(base_filename_, period_, period_tm, index);
+    if (filename == file_helper_->filename())
+    {
+        return; // e.g. the clock was set back into the current period
+    }
+
+    auto new_file = details::make_unique<FileHelper>(event_handlers_);
+    new_file->open(filename);
+    std::shared_ptr<FileHelper> rotated_file(std::move(file_helper_));
+    file_helper_ = std::move(new_file);
+
+    files_.push_back(file_info{rotated_file->filename(), current_size_, log_clock::now()});
+    files_size_ += current_size_;
+    current_size_ = file_helper_->size();
+    period_tm_ = period_tm;
+    index_ = index;
+
+    std::vector<filename_t> old_filenames = pop_old_files_();
+    housekeep_([rotated_file, old_filenames] {
+        rotated_file->close();
+        remove_files_(old_filenames);
+    });
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::housekeep_(const std::function<void()> &task)
+{
+    if (housekeeper_)
+    {
+        housekeeper_->post(task);
+    }
+    else
+    {
+        task();
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline filename_t hybrid_rotating_file_sink<Mutex, FileHelper>::period_stamp_(rotation_period period, const std::tm &tm)
+{
+    if (period == rotation_period::hourly)
+    {
+        return fmt_lib::format(
+            SPDLOG_FILENAME_T("{:04d}-{:02d}-{:02d}_{:02d}"), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour);
+    }
+    return fmt_lib::format(SPDLOG_FILENAME_T("{:04d}-{:02d}-{:02d}"), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+template<typename Mutex, typename FileHelper>
+inline filename_t hybrid_rotating_file_sink<Mutex, FileHelper>::make_filename_(
+    const filename_t &filename, const filename_t &stamp, std::size_t index)
+{
+    filename_t basename, ext;
+    std::tie(basename, ext) = details::file_helper::split_by_extension(filename);
+    if (index == 0)
+    {
+        return fmt_lib::format(SPDLOG_FILENAME_T("{}_{}{}"), basename, stamp, ext);
+    }
+    return fmt_lib::format(SPDLOG_FILENAME_T("{}_{}.{}{}"), basename, stamp, index, ext);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::scan_files_(const std::tm &now_tm)
+{
+    struct found_file
+    {
+        filename_t stamp;
+        std::size_t index;
+        file_info info;
+    };
+
+    filename_t dir = details::os::dir_name(base_filename_);
+    filename_t basename, ext;
+    std::tie(basename, ext) = details::file_helper::split_by_extension(base_filename_);
+    filename_t prefix = (dir.empty() ? basename : basename.substr(dir.size() + 1)) + '_';
+    // '0' - a digit
+    filename_t stamp_form = period_ == rotation_period::hourly ? SPDLOG_FILENAME_T("0000-00-00_00") : SPDLOG_FILENAME_T("0000-00-00");
+
+    std::vector<found_file> found;
+    DIR *dirp = ::opendir(dir.empty() ? "." : dir.c_str());
+    if (dirp == nullptr)
+    {
+        return; // nothing to continue - the directory is created by the file helper
+    }
+    while (const struct dirent *entry = ::readdir(dirp))
+    {
+        // prefix, stamp, optional ".index", ext
+        filename_t name = entry->d_name;
+        if (name.size() < prefix.size() + stamp_form.size() + ext.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+        {
+            continue;
+        }
+        filename_t stamp = name.substr(prefix.size(), stamp_form.size());
+        bool stamp_ok = true;
+        for (size_t i = 0; stamp_ok && i < stamp.size(); i++)
+        {
+            stamp_ok = stamp_form[i] == '0' ? stamp[i] >= '0' && stamp[i] <= '9' : stamp[i] == stamp_form[i];
+        }
+        filename_t rest = name.substr(prefix.size() + stamp.size(), name.size() - prefix.size() - stamp.size() - ext.size());
+        std::size_t index = 0;
+        if (!stamp_ok)
+        {
+            continue;
+        }
+        if (!rest.empty())
+        {
+            if (rest.size() < 2 || rest.size() > 19 || rest[0] != '.' || rest[1] == '0' ||
+                rest.find_first_not_of("0123456789", 1) != filename_t::npos)
+            {
+                continue;
+            }
+            index = static_cast<std::size_t>(std::strtoull(rest.c_str() + 1, nullptr, 10));
+        }
+
+        filename_t filename = make_filename_(base_filename_, stamp, index);
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0)
+        {
+            continue;
+        }
+        found.push_back(found_file{stamp, index, file_info{filename, static_cast<std::size_t>(st.st_size), log_clock::from_time_t(st.st_mtime)}});
+    }
+    ::closedir(dirp);
+
+    // the stamps sort as their time
+    std::sort(found.begin(), found.end(),
+        [](const found_file &a, const found_file &b) { return std::tie(a.stamp, a.index) < std::tie(b.stamp, b.index); });
+    // continue the last file of the current period. files of later periods (the clock was set back) are kept as newer.
+    filename_t now_stamp = period_stamp_(period_, now_tm);
+    auto current = std::find_if(
+        found.rbegin(), found.rend(), [&now_stamp](const found_file &f) { return f.stamp == now_stamp; });
+    if (current != found.rend())
+    {
+        index_ = current->index;
+        found.erase(std::next(current).base());
+    }
+    for (auto &f : found)
+    {
+        files_size_ += f.info.size;
+        files_.push_back(std::move(f.info));
+    }
+}
+
+// keep the current file, and the newest files within the limits
+template<typename Mutex, typename FileHelper>
+inline std::vector<filename_t> hybrid_rotating_file_sink<Mutex, FileHelper>::pop_old_files_()
+{
+    std::vector<filename_t> old_filenames;
+    auto now = log_clock::now();
+    while (!files_.empty())
+    {
+        const file_info &oldest = files_.front();
+        bool too_many = max_files_ > 0 && files_.size() + 1 > max_files_;
+        bool too_large = max_total_size_ > 0 && files_size_ + current_size_ > max_total_size_;
+        bool too_old = max_age_ > std::chrono::seconds::zero() && now - oldest.last_write > max_age_;
+        if (!too_many && !too_large && !too_old)
+        {
+            break;
+        }
+        files_size_ -= oldest.size;
+        old_filenames.push_back(oldest.filename);
+        files_.pop_front();
+    }
+    return old_filenames;
+}
+
+template<typename Mutex, typename FileHelper>
+inline void hybrid_rotating_file_sink<Mutex, FileHelper>::remove_files_(const std::vector<filename_t> &filenames)
+{
+    for (const auto &filename : filenames)
+    {
+        if (details::os::remove_if_exists(filename) != 0)
+        {
+            throw_spdlog_ex("hybrid_rotating_file_sink: failed removing " + details::os::filename_to_str(filename), errno);
+        }
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline log_clock::time_point hybrid_rotating_file_sink<Mutex, FileHelper>::next_rotation_tp_() const
+{
+    auto now = log_clock::now();
+    std::tm date = now_tm_(now);
+    if (period_ == rotation_period::daily)
+    {
+        date.tm_hour = 0;
+    }
+    date.tm_min = 0;
+    date.tm_sec = 0;
+    auto rotation_time = log_clock::from_time_t(std::mktime(&date));
+    if (rotation_time > now)
+    {
+        return rotation_time;
+    }
+    return {rotation_time + (period_ == rotation_period::daily ? std::chrono::hours(24) : std::chrono::hours(1))};
+}
+
+template<typename Mutex, typename FileHelper>
+inline std::tm hybrid_rotating_file_sink<Mutex, FileHelper>::now_tm_(log_clock::time_point tp) const
+{
+    return details::os::localtime(log_clock::to_time_t(tp));
+}
+
+} // namespace sinks
+} // namespace spdlog
@@ -0,0 +1,149 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/fd_file_helper.h>
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/file_housekeeper.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/synchronous_factory.h>
+
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+namespace sinks {
+
+// the time trigger of the hybrid rotating file sink
+enum class rotation_period
+{
+    hourly, // at the top of each hour: log_2024-01-01_10.txt
+    daily   // at midnight: log_2024-01-01.txt
+};
+
+//
+// Rotating file sink based on size and time - rolls to a new file at whichever comes first:
+// max_size bytes, or the start of the next period (hour or day).
+// The files are named by their period, with a sequence number when rolled on size:
+//    log_2024-01-01_10.txt, log_2024-01-01_10.1.txt, log_2024-01-01_10.2.txt, log_2024-01-01_11.txt ...
+// Nothing is renamed. On start, the last file of the current period is continued.
+//
+// Retention over all the files (the current one included), 0 for no limit:
+//    max_files      - keep at most that many files.
+//    max_total_size - keep at most that many bytes.
+//    max_age        - delete the files not written to for longer than that (checked on rotation).
+// The oldest files are deleted first. The files of previous runs are found by one directory scan on start.
+//
+template<typename Mutex, typename FileHelper = details::file_helper>
+class hybrid_rotating_file_sink final : public base_sink<Mutex>
+{
+public:
+    hybrid_rotating_file_sink(filename_t base_filename, std::size_t max_size, rotation_period period = rotation_period::hourly,
+        std::size_t max_files = 0, std::size_t max_total_size = 0, std::chrono::seconds max_age = std::chrono::seconds::zero(),
+        const file_event_handlers &event_handlers = {});
+
+    // e.g. calc_filename("logs/mylog.txt", rotation_period::hourly, tm, 2) => "logs/mylog_2024-01-01_10.2.txt"
+    static filename_t calc_filename(const filename_t &filename, rotation_period period, const std::tm &tm, std::size_t index);
+    filename_t filename();
+
+    // leave closing the rotated files and deleting the old ones to the housekeeper's thread,
+    // so a rotation costs the logging thread only the opening of the new file.
+    // nullptr (the default) does it all in the logging thread.
+    void set_housekeeper(std::shared_ptr<details::file_housekeeper> housekeeper);
+
+protected:
+    void sink_it_(const details::log_msg &msg) override;
+    bool writes_formatted_() const override;
+    void sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted) override;
+    void flush_() override;
+
+private:
+    struct file_info
+    {
+        filename_t filename;
+        std::size_t size;
+        log_clock::time_point last_write;
+    };
+
+    // write the formatted message of the given time, rolling first if needed
+    void write_(const memory_buf_t &formatted, log_clock::time_point time);
+    // roll on time if the message is past the period, or on size if it doesn't fit the current file
+    void roll_(log_clock::time_point time, std::size_t msg_size);
+    // continue in the file of the given period and index
+    void rotate_(const std::tm &period_tm, std::size_t index);
+
+    // run the task on the housekeeper's thread if any, or right away
+    void housekeep_(const std::function<void()> &task);
+
+    // "2024-01-01_10" (hourly) or "2024-01-01" (daily)
+    static filename_t period_stamp_(rotation_period period, const std::tm &tm);
+    static filename_t make_filename_(const filename_t &filename, const filename_t &stamp, std::size_t index);
+
+    // find the files of previous runs, in one scan of their directory.
+    // continue the last one if it is of the current period.
+    void scan_files_(const std::tm &now_tm);
+
+    // take the files out of files_ as the retention limits require, oldest first.
+    // return their names, to be deleted.
+    std::vector<filename_t> pop_old_files_();
+
+    // throw spdlog_ex on failure to delete some file.
+    static void remove_files_(const std::vector<filename_t> &filenames);
+
+    log_clock::time_point next_rotation_tp_() const;
+    std::tm now_tm_(log_clock::time_point tp) const;
+
+    filename_t base_filename_;
+    std::size_t max_size_;
+    rotation_period period_;
+    std::size_t max_files_;
+    std::size_t max_total_size_;
+    std::chrono::seconds max_age_;
+    file_event_handlers event_handlers_;
+    std::unique_ptr<FileHelper> file_helper_; // a pointer, so a rotated file can be handed to the housekeeper
+    std::size_t current_size_ = 0;
+    std::tm period_tm_; // of the current file
+    std::size_t index_ = 0; // of the current file in its period
+    log_clock::time_point rotation_tp_;
+    std::deque<file_info> files_; // the previous files, oldest first
+    std::size_t files_size_ = 0;  // the total size of files_
+    std::shared_ptr<details::file_housekeeper> housekeeper_;
+};
+
+using hybrid_rotating_file_sink_mt = hybrid_rotating_file_sink<std::mutex>;
+using hybrid_rotating_file_sink_st = hybrid_rotating_file_sink<details::null_mutex>;
+
+} // namespace sinks
+
+//
+// factory functions
+//
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> hybrid_rotating_logger_mt(const std::string &logger_name, const filename_t &filename,
+    size_t max_file_size, sinks::rotation_period period = sinks::rotation_period::hourly, size_t max_files = 0,
+    size_t max_total_size = 0, std::chrono::seconds max_age = std::chrono::seconds::zero(), const file_event_handlers &event_handlers = {})
+{
+    return Factory::template create<sinks::hybrid_rotating_file_sink_mt>(
+        logger_name, filename, max_file_size, period, max_files, max_total_size, max_age, event_handlers);
+}
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> hybrid_rotating_logger_st(const std::string &logger_name, const filename_t &filename,
+    size_t max_file_size, sinks::rotation_period period = sinks::rotation_period::hourly, size_t max_files = 0,
+    size_t max_total_size = 0, std::chrono::seconds max_age = std::chrono::seconds::zero(), const file_event_handlers &event_handlers = {})
+{
+    return Factory::template create<sinks::hybrid_rotating_file_sink_st>(
+        logger_name, filename, max_file_size, period, max_files, max_total_size, max_age, event_handlers);
+}
+} // namespace spdlog
+
+#include "hybrid_rotating_file_sink-inl.h"
@@ -25,7 +25,8 @@ public:
 protected:
     void sink_it_(const details::log_msg &msg) override
     {
-        memory_buf_t formatted;
+        details::pooled_buffer formatted_buf;
+        memory_buf_t &formatted = formatted_buf.get();
         base_sink<Mutex>::formatter_->format(msg, formatted);
         ostream_.write(formatted.data(), static_cast<std::streamsize>(formatted.size()));
         if (force_flush_)
@@ -9,23 +9,30 @@
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/fmt/fmt.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
+#include <cstdlib>
 #include <ctime>
 #include <mutex>
 #include <string>
 #include <tuple>
 
+#include <dirent.h>
+
 namespace spdlog {
 namespace sinks {
 
-template<typename Mutex>
-inline rotating_file_sink<Mutex>::rotating_file_sink(
-    filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open, const file_event_handlers &event_handlers)
+template<typename Mutex, typename FileHelper>
+inline rotating_file_sink<Mutex, FileHelper>::rotating_file_sink(
+    filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open, const file_event_handlers &event_handlers,
+    rotation_naming naming)
     : base_filename_(std::move(base_filename))
     , max_size_(max_size)
     , max_files_(max_files)
-    , file_helper_{event_handlers}
+    , naming_(naming)
+    , event_handlers_(event_handlers)
+    , file_helper_(make_file_helper_())
 {
     if (max_size == 0)
     {
@@ -36,8 +43,23 @@ inline rotating_file_sink<Mutex>::rotating_file_sink(
     {
         throw_spdlog_ex("rotating sink constructor: max_files arg cannot exceed 200000");
     }
-    file_helper_.open(calc_filename(base_filename_, 0));
-    current_size_ = file_helper_.size(); // expensive. called only once
+    if (naming_ == rotation_naming::monotonic)
+    {
+        // continue the newest file of the previous run
+        scan_monotonic_files_();
+        if (indices_.empty())
+        {
+            indices_.push_back(1);
+        }
+        remove_files_(pop_old_files_());
+        file_helper_->open(calc_filename(base_filename_, indices_.back()));
+    }
+    else
+    {
+        finish_pending_rotations_();
+        file_helper_->open(calc_filename(base_filename_, 0));
+    }
+    current_size_ = file_helper_->size(); // expensive. called only once
     if (rotate_on_open && current_size_ > 0)
     {
         rotate_();
@@ -47,8 +69,8 @@ inline rotating_file_sink<Mutex>::rotating_file_sink(
 
 // calc filename according to index and file extension if exists.
 // e.g. calc_filename("logs/mylog.txt, 3) => "logs/mylog.3.txt".
-template<typename Mutex>
-inline filename_t rotating_file_sink<Mutex>::calc_filename(const filename_t &filename, std::size_t index)
+template<typename Mutex, typename FileHelper>
+inline filename_t rotating_file_sink<Mutex, FileHelper>::calc_filename(const filename_t &filename, std::size_t index)
 {
     if (index == 0u)
     {
@@ -60,40 +82,122 @@ inline filename_t rotating_file_sink<Mutex>::calc_filename(const filename_t &fil
     return fmt_lib::format(SPDLOG_FILENAME_T("{}.{}{}"), basename, index, ext);
 }
 
-template<typename Mutex>
-inline filename_t rotating_file_sink<Mutex>::filename()
+template<typename Mutex, typename FileHelper>
+inline filename_t rotating_file_sink<Mutex, FileHelper>::filename()
+{
+    std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+    return file_helper_->filename();
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::set_housekeeper(std::shared_ptr<details::file_housekeeper> housekeeper)
 {
     std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
-    return file_helper_.filename();
+    housekeeper_ = housekeeper || !compressor_.enabled() ? std::move(housekeeper) : details::file_housekeeper::shared();
 }
 
-template<typename Mutex>
-inline void rotating_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::set_compression(file_compression compression, int level)
 {
-    memory_buf_t formatted;
+    details::file_compressor compressor(compression, level);
+    std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+    compressor_ = compressor;
+    if (compressor_.enabled() && !housekeeper_)
+    {
+        housekeeper_ = details::file_housekeeper::shared();
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::sink_it_(const details::log_msg &msg)
+{
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
     base_sink<Mutex>::formatter_->format(msg, formatted);
+    write_(formatted);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::write_(const memory_buf_t &formatted)
+{
     auto new_size = current_size_ + formatted.size();
 
     // rotate if the new estimated file size exceeds max size.
     // rotate only if the real size > 0 to better deal with full disk (see issue #2261).
     // we only check the real size when new_size > max_size_ because it is relatively expensive.
+    // the estimate is then corrected to the real size, which is smaller if the file helper
+    // compresses (see details::gzip_file_helper).
     if (new_size > max_size_)
     {
-        file_helper_.flush();
-        if (file_helper_.size() > 0)
+        file_helper_->flush();
+        current_size_ = file_helper_->size();
+        new_size = current_size_ + formatted.size();
+        if (new_size > max_size_ && current_size_ > 0)
         {
             rotate_();
             new_size = formatted.size();
         }
     }
-    file_helper_.write(formatted);
+    file_helper_->write(formatted);
     current_size_ = new_size;
 }
 
-template<typename Mutex>
-inline void rotating_file_sink<Mutex>::flush_()
+// format the batch into one buffer and write it at once.
+// the buffer is written out early only if a message needs the file to be rotated.
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::sink_batch_(const details::log_msg *msgs, size_t count)
 {
-    file_helper_.flush();
+    details::pooled_buffer pending_buf;
+    memory_buf_t &pending = pending_buf.get();
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
+    for (size_t i = 0; i < count; i++)
+    {
+        formatted.clear();
+        base_sink<Mutex>::formatter_->format(msgs[i], formatted);
+        if (current_size_ + pending.size() + formatted.size() > max_size_)
+        {
+            file_helper_->write(pending);
+            pending.clear();
+
+            // same as in write_(..)
+            file_helper_->flush();
+            current_size_ = file_helper_->size();
+            if (current_size_ + formatted.size() > max_size_ && current_size_ > 0)
+            {
+                rotate_();
+                current_size_ = 0;
+            }
+        }
+        pending.append(formatted.data(), formatted.data() + formatted.size());
+    }
+    file_helper_->write(pending);
+    current_size_ += pending.size();
+}
+
+template<typename Mutex, typename FileHelper>
+inline bool rotating_file_sink<Mutex, FileHelper>::writes_formatted_() const
+{
+    return true;
+}
+
+// a batch that needs the file to be rotated in its middle is formatted again by sink_batch_(..),
+// to find where to rotate.
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted)
+{
+    if (count == 1 || current_size_ + formatted.size() <= max_size_)
+    {
+        write_(formatted);
+        return;
+    }
+    sink_batch_(msgs, count);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::flush_()
+{
+    file_helper_->flush();
 }
 
 // Rotate files:
@@ -101,43 +205,284 @@ inline void rotating_file_sink<Mutex>::flush_()
 // log.1.txt -> log.2.txt
 // log.2.txt -> log.3.txt
 // log.3.txt -> delete
-template<typename Mutex>
-inline void rotating_file_sink<Mutex>::rotate_()
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::rotate_()
+{
+    if (naming_ == rotation_naming::monotonic)
+    {
+        rotate_monotonic_();
+        return;
+    }
+    if (housekeeper_)
+    {
+        rotate_in_background_();
+        return;
+    }
+
+    file_helper_->close();
+    try
+    {
+        shift_files_(base_filename_, max_files_, calc_filename(base_filename_, 0));
+    }
+    catch (...)
+    {
+        file_helper_->reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
+        current_size_ = 0;
+        throw;
+    }
+    file_helper_->reopen(true);
+}
+
+// log.txt -> log.txt.rotating.N, and continue in a new log.txt right away.
+// the housekeeper closes log.txt.rotating.N and shifts the files as rotate_() does.
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::rotate_in_background_()
+{
+    using details::os::filename_to_str;
+
+    filename_t filename = calc_filename(base_filename_, 0);
+    // unique among the renames still pending
+    filename_t rotated_filename = fmt_lib::format(SPDLOG_FILENAME_T("{}.rotating.{}"), filename, next_rotating_index_++);
+    if (!rename_file_(filename, rotated_filename))
+    {
+        file_helper_->reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
+        current_size_ = 0;
+        throw_spdlog_ex("rotating_file_sink: failed renaming " + filename_to_str(filename) + " to " + filename_to_str(rotated_filename), errno);
+    }
+    *renamed_to_ = rotated_filename;
+
+    std::shared_ptr<FileHelper> rotated_file = swap_file_(filename);
+    filename_t base_filename = base_filename_;
+    std::size_t max_files = max_files_;
+    details::file_compressor compressor = compressor_;
+    housekeeper_->post([rotated_file, rotated_filename, base_filename, max_files, compressor] {
+        rotated_file->close();
+        if (max_files == 0)
+        {
+            if (details::os::remove_if_exists(rotated_filename) != 0)
+            {
+                throw_spdlog_ex("rotating_file_sink: failed removing " + details::os::filename_to_str(rotated_filename), errno);
+            }
+            return;
+        }
+        shift_files_(base_filename, max_files, rotated_filename);
+        compressor.compress(calc_filename(base_filename, 1));
+    });
+}
+
+// log.1.txt, log.2.txt -> log.1.txt, log.2.txt, log.3.txt
+// nothing is renamed, so the cost doesn't depend on max_files.
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::rotate_monotonic_()
+{
+    auto rotated_index = indices_.back();
+    std::shared_ptr<FileHelper> rotated_file = swap_file_(calc_filename(base_filename_, rotated_index + 1));
+    indices_.push_back(rotated_index + 1);
+    std::vector<filename_t> old_filenames = pop_old_files_();
+    filename_t rotated_filename = max_files_ > 0 ? calc_filename(base_filename_, rotated_index) : filename_t{};
+    details::file_compressor compressor = compressor_;
+    housekeep_([rotated_file, old_filenames, rotated_filename, compressor] {
+        rotated_file->close();
+        remove_files_(old_filenames);
+        if (!rotated_filename.empty())
+        {
+            compressor.compress(rotated_filename);
+        }
+    });
+}
+
+template<typename Mutex, typename FileHelper>
+inline std::shared_ptr<FileHelper> rotating_file_sink<Mutex, FileHelper>::swap_file_(const filename_t &filename)
+{
+    auto old_renamed_to = renamed_to_;
+    std::unique_ptr<FileHelper> new_file;
+    try
+    {
+        new_file = make_file_helper_();
+        new_file->open(filename, true);
+    }
+    catch (...)
+    {
+        renamed_to_ = std::move(old_renamed_to);
+        throw;
+    }
+    std::shared_ptr<FileHelper> old_file(std::move(file_helper_));
+    file_helper_ = std::move(new_file);
+    return old_file;
+}
+
+template<typename Mutex, typename FileHelper>
+inline std::unique_ptr<FileHelper> rotating_file_sink<Mutex, FileHelper>::make_file_helper_()
+{
+    auto renamed_to = std::make_shared<filename_t>();
+    renamed_to_ = renamed_to;
+    file_event_handlers handlers = event_handlers_;
+    if (handlers.before_close)
+    {
+        auto before_close = handlers.before_close;
+        handlers.before_close = [before_close, renamed_to](const filename_t &filename, std::FILE *file_stream) {
+            before_close(renamed_to->empty() ? filename : *renamed_to, file_stream);
+        };
+    }
+    if (handlers.after_close)
+    {
+        auto after_close = handlers.after_close;
+        handlers.after_close = [after_close, renamed_to](const filename_t &filename) {
+            after_close(renamed_to->empty() ? filename : *renamed_to);
+        };
+    }
+    return details::make_unique<FileHelper>(handlers);
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::finish_pending_rotations_()
+{
+    filename_t filename = calc_filename(base_filename_, 0);
+    filename_t dir = details::os::dir_name(filename);
+    filename_t prefix = (dir.empty() ? filename : filename.substr(dir.size() + 1)) + SPDLOG_FILENAME_T(".rotating.");
+
+    DIR *dirp = ::opendir(dir.empty() ? "." : dir.c_str());
+    if (dirp == nullptr)
+    {
+        return;
+    }
+    std::vector<std::size_t> indices;
+    while (const struct dirent *entry = ::readdir(dirp))
+    {
+        filename_t name = entry->d_name;
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+        {
+            continue;
+        }
+        filename_t digits = name.substr(prefix.size());
+        if (digits.size() > 18 || digits[0] == '0' || digits.find_first_not_of("0123456789") != filename_t::npos)
+        {
+            continue;
+        }
+        indices.push_back(static_cast<std::size_t>(std::strtoull(digits.c_str(), nullptr, 10)));
+    }
+    ::closedir(dirp);
+
+    // renamed in the order of N, so the lowest is the oldest
+    std::sort(indices.begin(), indices.end());
+    for (auto n : indices)
+    {
+        filename_t rotated_filename = fmt_lib::format(SPDLOG_FILENAME_T("{}.rotating.{}"), filename, n);
+        if (max_files_ == 0)
+        {
+            remove_files_({rotated_filename});
+            continue;
+        }
+        shift_files_(base_filename_, max_files_, rotated_filename);
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::housekeep_(const std::function<void()> &task)
+{
+    if (housekeeper_)
+    {
+        housekeeper_->post(task);
+    }
+    else
+    {
+        task();
+    }
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::shift_files_(
+    const filename_t &base_filename, std::size_t max_files, const filename_t &first_filename)
 {
     using details::os::filename_to_str;
-    using details::os::path_exists;
 
-    file_helper_.close();
-    for (auto i = max_files_; i > 0; --i)
+    for (auto i = max_files; i > 0; --i)
     {
-        filename_t src = calc_filename(base_filename_, i - 1);
-        if (!path_exists(src))
+        filename_t src = i == 1 ? first_filename : calc_filename(base_filename, i - 1);
+        if (!details::file_compressor::exists(src))
         {
             continue;
         }
-        filename_t target = calc_filename(base_filename_, i);
+        filename_t target = calc_filename(base_filename, i);
 
-        if (!rename_file_(src, target))
+        if (details::file_compressor::rename(src, target) != 0)
         {
             // if failed try again after a small delay.
             // this is a workaround to a windows issue, where very high rotation
             // rates can cause the rename to fail with permission denied (because of antivirus?).
             details::os::sleep_for_millis(100);
-            if (!rename_file_(src, target))
+            if (details::file_compressor::rename(src, target) != 0)
             {
-                file_helper_.reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
-                current_size_ = 0;
                 throw_spdlog_ex("rotating_file_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target), errno);
             }
         }
     }
-    file_helper_.reopen(true);
+}
+// collect the indices of the existing "basename.N.ext" files (or compressed "basename.N.ext.gz"), sorted.
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::scan_monotonic_files_()
+{
+    filename_t dir = details::os::dir_name(base_filename_);
+    filename_t basename, ext;
+    std::tie(basename, ext) = details::file_helper::split_by_extension(base_filename_);
+    filename_t prefix = (dir.empty() ? basename : basename.substr(dir.size() + 1)) + '.';
+
+    DIR *dirp = ::opendir(dir.empty() ? "." : dir.c_str());
+    if (dirp == nullptr)
+    {
+        return; // nothing to continue - the directory is created by the file helper
+    }
+    while (const struct dirent *entry = ::readdir(dirp))
+    {
+        filename_t name = entry->d_name;
+        details::file_compressor::strip_suffix(name);
+        if (name.size() <= prefix.size() + ext.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+        {
+            continue;
+        }
+        filename_t digits = name.substr(prefix.size(), name.size() - prefix.size() - ext.size());
+        if (digits.size() > 18 || digits[0] == '0' || digits.find_first_not_of("0123456789") != filename_t::npos)
+        {
+            continue;
+        }
+        indices_.push_back(static_cast<std::size_t>(std::strtoull(digits.c_str(), nullptr, 10)));
+    }
+    ::closedir(dirp);
+    std::sort(indices_.begin(), indices_.end());
+    // a file found both as is and compressed is counted once
+    indices_.erase(std::unique(indices_.begin(), indices_.end()), indices_.end());
+}
+
+// keep the current file and the max_files files before it.
+template<typename Mutex, typename FileHelper>
+inline std::vector<filename_t> rotating_file_sink<Mutex, FileHelper>::pop_old_files_()
+{
+    std::vector<filename_t> old_filenames;
+    while (indices_.size() > max_files_ + 1)
+    {
+        old_filenames.push_back(calc_filename(base_filename_, indices_.front()));
+        indices_.pop_front();
+    }
+    return old_filenames;
+}
+
+template<typename Mutex, typename FileHelper>
+inline void rotating_file_sink<Mutex, FileHelper>::remove_files_(const std::vector<filename_t> &filenames)
+{
+    for (const auto &filename : filenames)
+    {
+        if (details::file_compressor::remove_if_exists(filename) != 0)
+        {
+            throw_spdlog_ex("rotating_file_sink: failed removing " + details::os::filename_to_str(filename), errno);
+        }
+    }
 }
 
 // delete the target if exists, and rename the src file  to target
 // return true on success, false otherwise.
-template<typename Mutex>
-inline bool rotating_file_sink<Mutex>::rename_file_(const filename_t &src_filename, const filename_t &target_filename)
+template<typename Mutex, typename FileHelper>
+inline bool rotating_file_sink<Mutex, FileHelper>::rename_file_(const filename_t &src_filename, const filename_t &target_filename)
 {
     // try to delete the target file in case it already exists.
     (void)details::os::remove(target_filename);
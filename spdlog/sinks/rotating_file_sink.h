@@ -4,50 +4,128 @@
 #pragma once
 
 #include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/fd_file_helper.h>
+#include <spdlog/details/file_compressor.h>
 #include <spdlog/details/file_helper.h>
+#include <spdlog/details/file_housekeeper.h>
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/details/synchronous_factory.h>
 
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace spdlog {
 namespace sinks {
 
+// how the rotating file sink names its files
+enum class rotation_naming
+{
+    // log.txt is written to, and rotated by renaming the older files one index up:
+    // log.txt -> log.1.txt -> log.2.txt ...
+    // the rename cost of each rotation grows with max_files.
+    shift,
+    // files are numbered in creation order and never renamed. the highest index is written to:
+    // log.1.txt, log.2.txt, ... log.N.txt
+    // each rotation opens the next index and deletes the oldest file, whatever max_files is.
+    monotonic
+};
+
 //
 // Rotating file sink based on size
 //
-template<typename Mutex>
+template<typename Mutex, typename FileHelper = details::file_helper>
 class rotating_file_sink final : public base_sink<Mutex>
 {
 public:
     rotating_file_sink(filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open = false,
-        const file_event_handlers &event_handlers = {});
+        const file_event_handlers &event_handlers = {}, rotation_naming naming = rotation_naming::shift);
     static filename_t calc_filename(const filename_t &filename, std::size_t index);
     filename_t filename();
 
+    // leave closing, renaming and deleting the rotated files to the housekeeper's thread,
+    // so a rotation costs the logging thread only the opening of the new file.
+    // with rotation_naming::shift the current file is first renamed to "log.txt.rotating.N",
+    // and renamed to log.1.txt by the housekeeper (the close handlers get the "rotating" name).
+    // the "rotating" files left by a process that exited before its housekeeper was done
+    // are shifted when the sink is created.
+    // nullptr (the default) does it all in the logging thread, unless the files are compressed.
+    void set_housekeeper(std::shared_ptr<details::file_housekeeper> housekeeper);
+
+    // compress each rotated file (log.1.txt -> log.1.txt.gz) on the housekeeper's thread -
+    // details::file_housekeeper::shared() if none was set.
+    // level - 1 (fastest) to 9 (smallest), or -1 for the default of the library.
+    // the compressed files count as the files they were in max_files.
+    void set_compression(file_compression compression, int level = -1);
+
 protected:
     void sink_it_(const details::log_msg &msg) override;
+    void sink_batch_(const details::log_msg *msgs, size_t count) override;
+    bool writes_formatted_() const override;
+    void sink_formatted_(const details::log_msg *msgs, size_t count, const memory_buf_t &formatted) override;
     void flush_() override;
 
 private:
+    // write the formatted message, rotating first if it doesn't fit the current file
+    void write_(const memory_buf_t &formatted);
     // Rotate files:
     // log.txt -> log.1.txt
     // log.1.txt -> log.2.txt
     // log.2.txt -> log.3.txt
     // log.3.txt -> delete
+    // or with rotation_naming::monotonic, open the next index and delete the oldest file.
     void rotate_();
+    void rotate_in_background_();
+    void rotate_monotonic_();
+
+    // open the given file, and return the previous one (still open)
+    std::shared_ptr<FileHelper> swap_file_(const filename_t &filename);
+
+    // a new file helper, whose close handlers get *renamed_to_ (if set) instead of the name it was opened with
+    std::unique_ptr<FileHelper> make_file_helper_();
+
+    // shift (or delete, if max_files is 0) the "log.txt.rotating.N" files left by a previous run, oldest first
+    void finish_pending_rotations_();
+
+    // run the task on the housekeeper's thread if any, or right away
+    void housekeep_(const std::function<void()> &task);
+
+    // log.2.txt -> log.3.txt, log.1.txt -> log.2.txt, first -> log.1.txt
+    // (the compressed files too, e.g. log.1.txt.gz -> log.2.txt.gz).
+    // throw spdlog_ex on failure to rename.
+    static void shift_files_(const filename_t &base_filename, std::size_t max_files, const filename_t &first_filename);
+
+    // find the files of a previous run (with rotation_naming::monotonic), in one scan of their directory
+    void scan_monotonic_files_();
+
+    // take the oldest files out of indices_, so no more than max_files + 1 files are kept.
+    // return their names, to be deleted (with rotation_naming::monotonic)
+    std::vector<filename_t> pop_old_files_();
+
+    // delete the files (as they are, and compressed).
+    // throw spdlog_ex on failure to delete some file.
+    static void remove_files_(const std::vector<filename_t> &filenames);
 
     // delete the target if exists, and rename the src file  to target
     // return true on success, false otherwise.
-    bool rename_file_(const filename_t &src_filename, const filename_t &target_filename);
+    static bool rename_file_(const filename_t &src_filename, const filename_t &target_filename);
 
     filename_t base_filename_;
     std::size_t max_size_;
     std::size_t max_files_;
     std::size_t current_size_;
-    details::file_helper file_helper_;
+    rotation_naming naming_;
+    std::deque<std::size_t> indices_; // with rotation_naming::monotonic - indices of the files on disk, oldest first
+    file_event_handlers event_handlers_;
+    std::size_t next_rotating_index_ = 1;     // the N of the next "log.txt.rotating.N"
+    std::shared_ptr<filename_t> renamed_to_; // the name of the current file, if renamed while open
+    std::unique_ptr<FileHelper> file_helper_; // a pointer, so a rotated file can be handed to the housekeeper
+    std::shared_ptr<details::file_housekeeper> housekeeper_;
+    details::file_compressor compressor_;
 };
 
 using rotating_file_sink_mt = rotating_file_sink<std::mutex>;
@@ -61,18 +139,20 @@ using rotating_file_sink_st = rotating_file_sink<details::null_mutex>;
 
 template<typename Factory = spdlog::synchronous_factory>
 inline std::shared_ptr<logger> rotating_logger_mt(const std::string &logger_name, const filename_t &filename, size_t max_file_size,
-    size_t max_files, bool rotate_on_open = false, const file_event_handlers &event_handlers = {})
+    size_t max_files, bool rotate_on_open = false, const file_event_handlers &event_handlers = {},
+    sinks::rotation_naming naming = sinks::rotation_naming::shift)
 {
     return Factory::template create<sinks::rotating_file_sink_mt>(
-        logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers);
+        logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers, naming);
 }
 
 template<typename Factory = spdlog::synchronous_factory>
 inline std::shared_ptr<logger> rotating_logger_st(const std::string &logger_name, const filename_t &filename, size_t max_file_size,
-    size_t max_files, bool rotate_on_open = false, const file_event_handlers &event_handlers = {})
+    size_t max_files, bool rotate_on_open = false, const file_event_handlers &event_handlers = {},
+    sinks::rotation_naming naming = sinks::rotation_naming::shift)
 {
     return Factory::template create<sinks::rotating_file_sink_st>(
-        logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers);
+        logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers, naming);
 }
 } // namespace spdlog
 
@@ -19,3 +19,26 @@ inline spdlog::level::level_enum spdlog::sinks::sink::level() const
 {
     return static_cast<spdlog::level::level_enum>(level_.load(std::memory_order_relaxed));
 }
+
+inline bool spdlog::sinks::sink::uses_payload() const
+{
+    return true;
+}
+
+inline size_t spdlog::sinks::sink::formatter_key() const
+{
+    return 0;
+}
+
+inline void spdlog::sinks::sink::log_formatted(const details::log_msg *msgs, size_t count, memory_buf_t &)
+{
+    log_batch(msgs, count);
+}
+
+inline void spdlog::sinks::sink::log_batch(const details::log_msg *msgs, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        log(msgs[i]);
+    }
+}
@@ -14,6 +14,18 @@ class sink
 public:
     virtual ~sink() = default;
     virtual void log(const details::log_msg &msg) = 0;
+    // log count consecutive messages. calls log(..) for each message by default.
+    virtual void log_batch(const details::log_msg *msgs, size_t count);
+    // return false if the sink writes msg.captured_args (when not empty) instead of msg.payload,
+    // so the async workers can skip formatting messages logged with deferred formatting.
+    virtual bool uses_payload() const;
+    // formatting shared between sinks: sinks with the same non zero formatter key get the messages formatted
+    // once, through log_formatted(..). the default is 0 - the sink formats the messages itself.
+    virtual size_t formatter_key() const;
+    // log count consecutive messages, with formatted holding their formatting by an equivalent formatter.
+    // if formatted is empty, the sink formats them into it, to be reused by the next sinks.
+    // calls log_batch(..) by default.
+    virtual void log_formatted(const details::log_msg *msgs, size_t count, memory_buf_t &formatted);
     virtual void flush() = 0;
     virtual void set_pattern(const std::string &pattern) = 0;
     virtual void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) = 0;
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <spdlog/details/console_globals.h>
+#include <spdlog/details/buffer_pool.h>
 #include <spdlog/pattern_formatter.h>
 #include <memory>
 
@@ -23,7 +24,8 @@ template<typename ConsoleMutex>
 inline void stdout_sink_base<ConsoleMutex>::log(const details::log_msg &msg)
 {
     std::lock_guard<mutex_t> lock(mutex_);
-    memory_buf_t formatted;
+    details::pooled_buffer formatted_buf;
+    memory_buf_t &formatted = formatted_buf.get();
     formatter_->format(msg, formatted);
     ::fwrite(formatted.data(), sizeof(char), formatted.size(), file_);
     ::fflush(file_); // flush every line to terminal
@@ -48,7 +48,8 @@ protected:
     void sink_it_(const details::log_msg &msg) override
     {
         string_view_t payload;
-        memory_buf_t formatted;
+        details::pooled_buffer formatted_buf;
+        memory_buf_t &formatted = formatted_buf.get();
         if (enable_formatting_)
         {
             base_sink<Mutex>::formatter_->format(msg, formatted);
@@ -38,6 +38,50 @@
 // #define SPDLOG_NO_TLS
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the max capacity (in bytes) the thread local formatting
+// buffers keep between the calls (see details/buffer_pool.h).
+// buffers that grew larger are freed after use.
+//
+// #define SPDLOG_BUFFER_POOL_MAX_CAPACITY (64 * 1024)
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the default buffer size (in bytes) of
+// details::fd_file_helper<>, the buffered file backend of the file sinks.
+//
+// #define SPDLOG_FD_FILE_BUFFER_SIZE (256 * 1024)
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the defaults of details::io_uring_file_helper<>:
+// the size of each buffer and the number of buffers (max writes in flight).
+//
+// #define SPDLOG_IO_URING_BUFFER_SIZE (64 * 1024)
+// #define SPDLOG_IO_URING_MAX_IN_FLIGHT 8
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the default size (in bytes, a multiple of the page size)
+// of the mapped window of details::mmap_file_helper<>.
+//
+// #define SPDLOG_MMAP_WINDOW_SIZE (4 * 1024 * 1024)
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the default compression level (1 to 9) of
+// details::gzip_file_helper<>, the gzip compressed file backend of the file sinks.
+//
+// #define SPDLOG_GZIP_FILE_LEVEL 6
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to enable the gzip compression of rotated log files
+// (file_compression::gzip). Needs zlib (link with -lz).
+//
+// #define SPDLOG_USE_ZLIB
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment to use C++20 std::format instead of fmt. This removes compile
 // time checking of format strings, but doesn't depend on the fmt library.
@@ -0,0 +1,103 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+// Decode files written by spdlog::sinks::binary_file_sink to text, formatted
+// with the given pattern (the default spdlog pattern if none).
+//
+// usage: binary_log_decoder <file> [pattern] [--utc]
+// build: g++ -std=c++11 -O2 -I<spdlog-mini dir> binary_log_decoder.cpp -o binary_log_decoder -pthread
+
+#include <spdlog/details/binary_log.h>
+#include <spdlog/pattern_formatter.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+// %P - the pid of the process that wrote the records (from the file), not the decoder's own
+class logged_pid_formatter final : public spdlog::custom_flag_formatter
+{
+public:
+    explicit logged_pid_formatter(const spdlog::details::binary_log_decoder &decoder)
+        : decoder_(decoder)
+    {}
+
+    void format(const spdlog::details::log_msg &, const std::tm &, spdlog::memory_buf_t &dest) override
+    {
+        auto pid = static_cast<uint32_t>(decoder_.pid());
+        spdlog::details::scoped_padder p(spdlog::details::scoped_padder::count_digits(pid), padinfo_, dest);
+        spdlog::details::fmt_helper::append_int(pid, dest);
+    }
+
+    std::unique_ptr<custom_flag_formatter> clone() const override
+    {
+        return spdlog::details::make_unique<logged_pid_formatter>(decoder_);
+    }
+
+private:
+    const spdlog::details::binary_log_decoder &decoder_;
+};
+
+int main(int argc, char *argv[])
+{
+    const char *filename = nullptr;
+    const char *pattern = nullptr;
+    auto time_type = spdlog::pattern_time_type::local;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--utc") == 0)
+        {
+            time_type = spdlog::pattern_time_type::utc;
+        }
+        else if (filename == nullptr)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            pattern = argv[i];
+        }
+    }
+    if (filename == nullptr)
+    {
+        std::fprintf(stderr, "usage: %s <file> [pattern] [--utc]\n", argv[0]);
+        return 2;
+    }
+
+    std::FILE *in = std::fopen(filename, "rb");
+    if (in == nullptr)
+    {
+        std::perror(filename);
+        return 1;
+    }
+
+    int rc = 0;
+    try
+    {
+        spdlog::details::binary_log_decoder decoder(in);
+        spdlog::pattern_formatter formatter(time_type);
+        formatter.add_flag<logged_pid_formatter>('P', decoder);
+        formatter.set_pattern(pattern != nullptr ? pattern : "%+");
+
+        spdlog::details::log_msg msg;
+        spdlog::memory_buf_t formatted;
+        while (decoder.next(msg))
+        {
+            formatted.clear();
+            formatter.format(msg, formatted);
+            std::fwrite(formatted.data(), 1, formatted.size(), stdout);
+        }
+        if (decoder.skipped_bytes() > 0)
+        {
+            std::fprintf(stderr, "%s: skipped %zu damaged bytes\n", filename, decoder.skipped_bytes());
+            rc = 1;
+        }
+    }
+    catch (const spdlog::spdlog_ex &ex)
+    {
+        std::fprintf(stderr, "%s: %s\n", filename, ex.what());
+        rc = 1;
+    }
+    std::fclose(in);
+    return rc;
+}